@@ -0,0 +1,115 @@
+/** \file
+ *
+ *  HID keyboard usages and report layout for building ../src/KeyMap.c outside of LUFA. The names
+ *  and values are those of LUFA/Drivers/USB/Class/Common/HIDClassCommon.h, only the ones the key
+ *  mapping uses are defined.
+ */
+
+#ifndef _HID_USAGES_H_
+#define _HID_USAGES_H_
+
+	/* Includes: */
+		#include <stdint.h>
+
+	/* Macros: */
+		#define HID_KEYBOARD_MODIFIER_LEFTCTRL                    (1 << 0)
+		#define HID_KEYBOARD_MODIFIER_LEFTSHIFT                   (1 << 1)
+		#define HID_KEYBOARD_MODIFIER_LEFTALT                     (1 << 2)
+		#define HID_KEYBOARD_MODIFIER_LEFTGUI                     (1 << 3)
+		#define HID_KEYBOARD_MODIFIER_RIGHTCTRL                   (1 << 4)
+		#define HID_KEYBOARD_MODIFIER_RIGHTSHIFT                  (1 << 5)
+		#define HID_KEYBOARD_MODIFIER_RIGHTALT                    (1 << 6)
+		#define HID_KEYBOARD_MODIFIER_RIGHTGUI                    (1 << 7)
+
+		#define HID_KEYBOARD_SC_A                                 0x04
+		#define HID_KEYBOARD_SC_B                                 0x05
+		#define HID_KEYBOARD_SC_C                                 0x06
+		#define HID_KEYBOARD_SC_D                                 0x07
+		#define HID_KEYBOARD_SC_E                                 0x08
+		#define HID_KEYBOARD_SC_F                                 0x09
+		#define HID_KEYBOARD_SC_G                                 0x0A
+		#define HID_KEYBOARD_SC_H                                 0x0B
+		#define HID_KEYBOARD_SC_I                                 0x0C
+		#define HID_KEYBOARD_SC_J                                 0x0D
+		#define HID_KEYBOARD_SC_K                                 0x0E
+		#define HID_KEYBOARD_SC_L                                 0x0F
+		#define HID_KEYBOARD_SC_M                                 0x10
+		#define HID_KEYBOARD_SC_N                                 0x11
+		#define HID_KEYBOARD_SC_O                                 0x12
+		#define HID_KEYBOARD_SC_P                                 0x13
+		#define HID_KEYBOARD_SC_Q                                 0x14
+		#define HID_KEYBOARD_SC_R                                 0x15
+		#define HID_KEYBOARD_SC_S                                 0x16
+		#define HID_KEYBOARD_SC_T                                 0x17
+		#define HID_KEYBOARD_SC_U                                 0x18
+		#define HID_KEYBOARD_SC_V                                 0x19
+		#define HID_KEYBOARD_SC_W                                 0x1A
+		#define HID_KEYBOARD_SC_X                                 0x1B
+		#define HID_KEYBOARD_SC_Y                                 0x1C
+		#define HID_KEYBOARD_SC_Z                                 0x1D
+		#define HID_KEYBOARD_SC_1_AND_EXCLAMATION                 0x1E
+		#define HID_KEYBOARD_SC_2_AND_AT                          0x1F
+		#define HID_KEYBOARD_SC_3_AND_HASHMARK                    0x20
+		#define HID_KEYBOARD_SC_4_AND_DOLLAR                      0x21
+		#define HID_KEYBOARD_SC_5_AND_PERCENTAGE                  0x22
+		#define HID_KEYBOARD_SC_6_AND_CARET                       0x23
+		#define HID_KEYBOARD_SC_7_AND_AMPERSAND                   0x24
+		#define HID_KEYBOARD_SC_8_AND_ASTERISK                    0x25
+		#define HID_KEYBOARD_SC_9_AND_OPENING_PARENTHESIS         0x26
+		#define HID_KEYBOARD_SC_0_AND_CLOSING_PARENTHESIS         0x27
+		#define HID_KEYBOARD_SC_ENTER                             0x28
+		#define HID_KEYBOARD_SC_ESCAPE                            0x29
+		#define HID_KEYBOARD_SC_BACKSPACE                         0x2A
+		#define HID_KEYBOARD_SC_TAB                               0x2B
+		#define HID_KEYBOARD_SC_SPACE                             0x2C
+		#define HID_KEYBOARD_SC_MINUS_AND_UNDERSCORE              0x2D
+		#define HID_KEYBOARD_SC_EQUAL_AND_PLUS                    0x2E
+		#define HID_KEYBOARD_SC_OPENING_BRACKET_AND_OPENING_BRACE 0x2F
+		#define HID_KEYBOARD_SC_CLOSING_BRACKET_AND_CLOSING_BRACE 0x30
+		#define HID_KEYBOARD_SC_BACKSLASH_AND_PIPE                0x31
+		#define HID_KEYBOARD_SC_SEMICOLON_AND_COLON               0x33
+		#define HID_KEYBOARD_SC_APOSTROPHE_AND_QUOTE              0x34
+		#define HID_KEYBOARD_SC_GRAVE_ACCENT_AND_TILDE            0x35
+		#define HID_KEYBOARD_SC_COMMA_AND_LESS_THAN_SIGN          0x36
+		#define HID_KEYBOARD_SC_DOT_AND_GREATER_THAN_SIGN         0x37
+		#define HID_KEYBOARD_SC_SLASH_AND_QUESTION_MARK           0x38
+		#define HID_KEYBOARD_SC_CAPS_LOCK                         0x39
+		#define HID_KEYBOARD_SC_F1                                0x3A
+		#define HID_KEYBOARD_SC_F2                                0x3B
+		#define HID_KEYBOARD_SC_F3                                0x3C
+		#define HID_KEYBOARD_SC_F4                                0x3D
+		#define HID_KEYBOARD_SC_F5                                0x3E
+		#define HID_KEYBOARD_SC_F6                                0x3F
+		#define HID_KEYBOARD_SC_F7                                0x40
+		#define HID_KEYBOARD_SC_F8                                0x41
+		#define HID_KEYBOARD_SC_F9                                0x42
+		#define HID_KEYBOARD_SC_F10                               0x43
+		#define HID_KEYBOARD_SC_F11                               0x44
+		#define HID_KEYBOARD_SC_F12                               0x45
+		#define HID_KEYBOARD_SC_INSERT                            0x49
+		#define HID_KEYBOARD_SC_HOME                              0x4A
+		#define HID_KEYBOARD_SC_PAGE_UP                           0x4B
+		#define HID_KEYBOARD_SC_DELETE                            0x4C
+		#define HID_KEYBOARD_SC_END                               0x4D
+		#define HID_KEYBOARD_SC_PAGE_DOWN                         0x4E
+		#define HID_KEYBOARD_SC_RIGHT_ARROW                       0x4F
+		#define HID_KEYBOARD_SC_LEFT_ARROW                        0x50
+		#define HID_KEYBOARD_SC_DOWN_ARROW                        0x51
+		#define HID_KEYBOARD_SC_UP_ARROW                          0x52
+		#define HID_KEYBOARD_SC_NON_US_BACKSLASH_AND_PIPE         0x64
+		#define HID_KEYBOARD_SC_LEFT_GUI                          0xE3
+		#define HID_KEYBOARD_SC_MEDIA_PREVIOUS_TRACK              0xEA
+		#define HID_KEYBOARD_SC_MEDIA_NEXT_TRACK                  0xEB
+		#define HID_KEYBOARD_SC_MEDIA_VOLUME_UP                   0xED
+		#define HID_KEYBOARD_SC_MEDIA_VOLUME_DOWN                 0xEE
+
+	/* Type Defines: */
+		/** Boot protocol keyboard report, laid out like the one of LUFA. */
+		typedef struct
+		{
+			uint8_t Modifier;
+			uint8_t Reserved;
+			uint8_t KeyCode[6];
+		} USB_KeyboardReport_Data_t;
+
+#endif
@@ -0,0 +1,297 @@
+/** \file
+ *
+ *  Test of the boot handshake and supervision (../src/KeyboardLink.c) against a simulated keyboard
+ *  on the modem lines, which a pseudo terminal does not have. The KeyboardPort_* functions are
+ *  implemented on a model of the keyboard instead of a serial port: it raises DCD some time after
+ *  its supply (DTR) comes on, sends its id string once RTS goes high, and drops DCD when it dies.
+ *  Time advances in steps of one millisecond.
+ *
+ *    make check
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "KeyboardLink.h"
+
+/** Limits the firmware promises, see KeyboardLink_Task() and KeyboardLink_KeepAwakeTask(). */
+#define BOOT_MAX_MS          100
+#define KEEPAWAKE_INTERVAL_MS (7UL * 60 * 1000)
+
+static struct
+{
+  uint32_t Now;                 //!< simulated time in milliseconds
+
+  /* lines as the port drives them */
+  bool Power;
+  bool RTSDriven;               //!< RTS is driven, not released
+  bool RTSHigh;                 //!< level RTS is driven to
+
+  /* keyboard model */
+  bool PullsUpRTS;              //!< reads a released RTS as high while powered
+  uint8_t DeadBoots;            //!< boots in which the keyboard does not raise DCD
+  uint8_t SilentBoots;          //!< boots in which the keyboard does not send its id
+  bool Crashed;                 //!< browned out, DCD stays low until the next power cycle
+  uint32_t PowerOnTime;
+  bool DCD;
+  bool RTSWasHigh;              //!< RTS level seen at the last step
+  uint32_t IdDue;               //!< time to send the id string, 0 if none is due
+  uint8_t IdBytes;              //!< bytes of the id string sent since KeyboardPort_StartId()
+
+  /* observations */
+  uint16_t Boots;               //!< times the supply was switched on
+  uint16_t BackPowered;         //!< steps in which RTS was driven high with the supply off
+  uint16_t RTSPulses;           //!< falling edges of RTS while the keyboard was up
+} Sim;
+
+static unsigned Failures;
+
+#define CHECK(condition, ...)                   \
+  do {                                          \
+    if (!(condition))                           \
+      {                                         \
+        printf("FAIL line %d: ", __LINE__);     \
+        printf(__VA_ARGS__);                    \
+        printf("\n");                           \
+        Failures++;                             \
+      }                                         \
+  } while (0)
+
+/* lines to the keyboard, for KeyboardLink.c */
+
+void KeyboardPort_SetPower(const bool On)
+{
+  if (On && !Sim.Power)
+    {
+      Sim.Boots++;
+      Sim.PowerOnTime = Sim.Now;
+    }
+  if (!On)
+    {
+      Sim.DCD = false;
+      Sim.Crashed = false;
+      Sim.IdDue = 0;
+    }
+  Sim.Power = On;
+}
+
+bool KeyboardPort_GetDCD(void)
+{
+  return Sim.DCD;
+}
+
+bool KeyboardPort_GetRTS(void)
+{
+  if (Sim.RTSDriven)
+    return Sim.RTSHigh;
+  return Sim.Power && Sim.PullsUpRTS;
+}
+
+void KeyboardPort_SetRTS(const bool High)
+{
+  Sim.RTSDriven = true;
+  Sim.RTSHigh = High;
+}
+
+void KeyboardPort_ReleaseRTS(void)
+{
+  Sim.RTSDriven = false;
+}
+
+void KeyboardPort_StartId(void)
+{
+  Sim.IdBytes = 0;
+}
+
+uint8_t KeyboardPort_IdProgress(void)
+{
+  return Sim.IdBytes;
+}
+
+void KeyboardPort_FinishId(void)
+{
+}
+
+/** Starts a new test with an unpowered keyboard. */
+static void Sim_Reset(KeyboardLink_t* const Link)
+{
+  memset(&Sim, 0, sizeof(Sim));
+  memset(Link, 0, sizeof(*Link));
+  Sim.Now = 1000;
+}
+
+/** The keyboard's side of one millisecond. */
+static void Sim_Keyboard(void)
+{
+  bool rts = KeyboardPort_GetRTS();
+
+  if (!Sim.Power && Sim.RTSDriven && Sim.RTSHigh)
+    Sim.BackPowered++;
+
+  if (Sim.Power && !Sim.DCD && !Sim.Crashed && (Sim.Boots > Sim.DeadBoots) && (Sim.Now - Sim.PowerOnTime >= 8))
+    Sim.DCD = true;
+
+  if (Sim.DCD)
+    {
+      if (Sim.RTSWasHigh && !rts)
+        Sim.RTSPulses++;
+      // the id string follows a rising edge of RTS
+      if (!Sim.RTSWasHigh && rts && (Sim.Boots > Sim.SilentBoots))
+        Sim.IdDue = Sim.Now + 3;
+      if (Sim.IdDue && (Sim.Now >= Sim.IdDue))
+        {
+          Sim.IdBytes++;
+          Sim.IdDue = (Sim.IdBytes < 2) ? Sim.Now + 1 : 0;
+        }
+    }
+  Sim.RTSWasHigh = rts;
+}
+
+/** Runs the link for \p Milliseconds, or until it reports \p Until.
+ *  \return the time the event came, 0 if it did not
+ */
+static uint32_t Sim_Run(KeyboardLink_t* const Link, const uint32_t Milliseconds, const KeyboardLinkEvent_t Until)
+{
+  for (uint32_t end = Sim.Now + Milliseconds; Sim.Now < end; Sim.Now++)
+    {
+      Sim_Keyboard();
+      KeyboardLinkEvent_t event = KeyboardLink_Task(Link, Sim.Now);
+      if (KeyboardLink_Ready(Link))
+        KeyboardLink_KeepAwakeTask(Link, Sim.Now);
+      if ((Until != LINK_EVENT_NONE) && (event == Until))
+        return Sim.Now++;
+    }
+  return 0;
+}
+
+/** Boots a keyboard that answers right away. */
+static void Test_ColdBoot(const bool PullsUpRTS)
+{
+  KeyboardLink_t link;
+
+  Sim_Reset(&link);
+  Sim.PullsUpRTS = PullsUpRTS;
+  uint32_t start = Sim.Now;
+  KeyboardLink_Boot(&link, Sim.Now);
+
+  uint32_t ready = Sim_Run(&link, 1000, LINK_EVENT_READY);
+  CHECK(ready && (ready - start < BOOT_MAX_MS), "%s: ready after %lu ms", PullsUpRTS ? "RTS pulled up" : "cold boot",
+        ready ? (unsigned long)(ready - start) : 0UL);
+  CHECK(Sim.Boots == 1, "one power cycle expected, got %u", Sim.Boots);
+  CHECK(Sim.IdBytes == 2, "id string not received");
+  CHECK(KeyboardPort_GetRTS(), "RTS low once ready");
+  CHECK(Sim.BackPowered == 0, "RTS driven high for %u ms with the supply off", Sim.BackPowered);
+  // a keyboard that already sees RTS high gets it pulsed low first
+  CHECK(Sim.RTSPulses == (PullsUpRTS ? 1 : 0), "%u RTS pulses", Sim.RTSPulses);
+}
+
+/** A keyboard that does not come up, or stays silent, is power cycled again. */
+static void Test_Retries(void)
+{
+  KeyboardLink_t link;
+
+  Sim_Reset(&link);
+  Sim.DeadBoots = 1;
+  KeyboardLink_Boot(&link, Sim.Now);
+  CHECK(Sim_Run(&link, 1000, LINK_EVENT_READY), "no DCD: never ready");
+  CHECK(Sim.Boots == 2, "no DCD: %u power cycles, expected 2", Sim.Boots);
+  CHECK(Sim.BackPowered == 0, "no DCD: RTS driven high for %u ms with the supply off", Sim.BackPowered);
+
+  Sim_Reset(&link);
+  Sim.SilentBoots = 2;
+  KeyboardLink_Boot(&link, Sim.Now);
+  CHECK(Sim_Run(&link, 1000, LINK_EVENT_READY), "no id: never ready");
+  CHECK(Sim.Boots == 3, "no id: %u power cycles, expected 3", Sim.Boots);
+  // RTS was high when the silent keyboard was cut off
+  CHECK(Sim.BackPowered == 0, "no id: RTS driven high for %u ms with the supply off", Sim.BackPowered);
+}
+
+/** A keyboard that drops DCD is reported lost and booted again. */
+static void Test_Recovery(void)
+{
+  KeyboardLink_t link;
+
+  Sim_Reset(&link);
+  KeyboardLink_Boot(&link, Sim.Now);
+  Sim_Run(&link, 1000, LINK_EVENT_READY);
+  Sim_Run(&link, 500, LINK_EVENT_NONE);
+  CHECK(KeyboardLink_Ready(&link), "not ready before the brown out");
+
+  // a short glitch of DCD is ignored
+  Sim.DCD = false;
+  Sim.Crashed = true;
+  Sim_Run(&link, 5, LINK_EVENT_NONE);
+  Sim.Crashed = false;
+  CHECK(!Sim_Run(&link, 100, LINK_EVENT_LOST), "DCD glitch taken for a lost keyboard");
+
+  Sim.DCD = false;
+  Sim.Crashed = true;
+  CHECK(Sim_Run(&link, 100, LINK_EVENT_LOST), "lost keyboard not noticed");
+  CHECK(!KeyboardLink_Ready(&link), "still ready after the keyboard was lost");
+  CHECK(Sim_Run(&link, 1000, LINK_EVENT_READY), "lost keyboard not booted again");
+  CHECK(link.Recoveries == 1, "%u recoveries", link.Recoveries);
+  CHECK(link.RecoveryTime < BOOT_MAX_MS + 30, "recovery took %u ms", link.RecoveryTime);
+  CHECK(Sim.BackPowered == 0, "RTS driven high for %u ms with the supply off", Sim.BackPowered);
+}
+
+/** RTS is pulsed every 7 minutes without key presses, a key press starts the interval over. */
+static void Test_KeepAwake(void)
+{
+  KeyboardLink_t link;
+
+  Sim_Reset(&link);
+  KeyboardLink_Boot(&link, Sim.Now);
+  Sim_Run(&link, 1000, LINK_EVENT_READY);
+
+  Sim_Run(&link, KEEPAWAKE_INTERVAL_MS - 10, LINK_EVENT_NONE);
+  CHECK(Sim.RTSPulses == 0, "RTS pulsed before 7 minutes");
+  Sim_Run(&link, 30, LINK_EVENT_NONE);
+  CHECK(Sim.RTSPulses == 1, "%u RTS pulses after 7 minutes", Sim.RTSPulses);
+  CHECK(KeyboardPort_GetRTS(), "RTS low after the pulse");
+
+  Sim_Run(&link, KEEPAWAKE_INTERVAL_MS / 2, LINK_EVENT_NONE);
+  KeyboardLink_ByteReceived(&link, Sim.Now);
+  Sim_Run(&link, KEEPAWAKE_INTERVAL_MS - 10, LINK_EVENT_NONE);
+  CHECK(Sim.RTSPulses == 1, "a key press did not restart the keep awake interval");
+  CHECK(KeyboardLink_Ready(&link), "keyboard lost during the keep awake pulses");
+}
+
+/** A keyboard still up after a restart is taken over, a dead one is not. */
+static void Test_Resume(void)
+{
+  KeyboardLink_t link;
+
+  Sim_Reset(&link);
+  Sim.Power = true;
+  Sim.DCD = true;
+  CHECK(KeyboardLink_Resume(&link, Sim.Now), "keyboard with DCD high not resumed");
+  CHECK(KeyboardLink_Ready(&link) && KeyboardPort_GetRTS(), "resumed keyboard not ready with RTS high");
+  CHECK(Sim.Boots == 0, "resumed keyboard was power cycled");
+
+  Sim_Reset(&link);
+  Sim.Power = true;
+  CHECK(!KeyboardLink_Resume(&link, Sim.Now), "keyboard with DCD low resumed");
+  KeyboardLink_Boot(&link, Sim.Now);
+  CHECK(Sim_Run(&link, 1000, LINK_EVENT_READY), "keyboard not booted after a failed resume");
+  CHECK(Sim.BackPowered == 0, "RTS driven high for %u ms with the supply off", Sim.BackPowered);
+}
+
+int main(void)
+{
+  Test_ColdBoot(false);
+  Test_ColdBoot(true);
+  Test_Retries();
+  Test_Recovery();
+  Test_KeepAwake();
+  Test_Resume();
+
+  if (Failures)
+    {
+      printf("%u failures\n", Failures);
+      return EXIT_FAILURE;
+    }
+
+  printf("keyboard link: all tests passed\n");
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,145 @@
+#!/usr/bin/env python3
+"""Scripted Palm Portable Keyboard on a pseudo terminal, to test ppkd without the hardware.
+
+The emulator sends the keyboard's id string and then the make and break codes of a script, one
+command per line ('#' starts a comment):
+
+  down KEY / up KEY / tap KEY   key pressed, released, or both (KEY as in KEYS below, or 0xNN)
+  releaseall                    repeat the last break code, the keyboard's way to release all keys
+  sleep MS                      pause
+  expect LINE                   ppkd --print is expected to print LINE, in this order
+
+A pseudo terminal has no modem lines, so ppkd has to run with --no-modem. Given a command after
+'--', the emulator starts it with {tty} replaced by the terminal, checks its output against the
+expect lines and exits non-zero on a mismatch:
+
+  ppk_emulator.py --script keyboard_test.txt -- ./ppkd --no-modem --print {tty}
+
+Without a command it prints the terminal and waits for ppkd to be started by hand.
+"""
+
+import argparse
+import os
+import subprocess
+import sys
+import time
+import tty
+
+ID = bytes([0xFA, 0xFD])
+RELEASED = 0x80
+
+# Matrix positions of the keys, see PalmPortable_ProcessByte() in src/KeyMap.c
+KEYS = {
+    '1': 0x00, '2': 0x01, '3': 0x02, 'z': 0x03, '4': 0x04, '5': 0x05, '6': 0x06, '7': 0x07,
+    'cmd': 0x08, 'q': 0x09, 'w': 0x0A, 'e': 0x0B, 'r': 0x0C, 't': 0x0D, 'y': 0x0E, 'space2': 0x0F,
+    'x': 0x10, 'a': 0x11, 's': 0x12, 'd': 0x13, 'f': 0x14, 'g': 0x15, 'h': 0x16, 'space': 0x17,
+    'capslock': 0x18, 'tab': 0x19, 'ctrl': 0x1A, 'fn': 0x22, 'alt': 0x23,
+    'c': 0x2C, 'v': 0x2D, 'b': 0x2E, 'n': 0x2F,
+    '-': 0x30, '=': 0x31, 'backspace': 0x32, 'sf1': 0x33, '8': 0x34, '9': 0x35, '0': 0x36, 'space3': 0x37,
+    '[': 0x38, ']': 0x39, '\\': 0x3A, 'sf2': 0x3B, 'u': 0x3C, 'i': 0x3D, 'o': 0x3E, 'p': 0x3F,
+    "'": 0x40, 'enter': 0x41, 'sf3': 0x42, 'j': 0x44, 'k': 0x45, 'l': 0x46, ';': 0x47,
+    '/': 0x48, 'up': 0x49, 'sf4': 0x4A, 'm': 0x4C, ',': 0x4D, '.': 0x4E, 'done': 0x4F,
+    'del': 0x50, 'left': 0x51, 'down': 0x52, 'right': 0x53, 'lshift': 0x58, 'rshift': 0x59,
+}
+
+
+def key_code(name):
+    return int(name, 16) if name.startswith('0x') else KEYS[name]
+
+
+class Keyboard:
+    def __init__(self, master):
+        self.master = master
+        self.last = None
+
+    def send(self, code):
+        os.write(self.master, bytes([code]))
+        self.last = code
+        time.sleep(0.002)   # a byte takes about 1ms at 9600 baud
+
+    def run(self, script):
+        """Plays the script, returns the expected output lines."""
+        expected = []
+        for number, line in enumerate(script, 1):
+            line = line.split('#', 1)[0].strip()
+            if not line:
+                continue
+            command, _, argument = line.partition(' ')
+            argument = argument.strip()
+            if command == 'down':
+                self.send(key_code(argument))
+            elif command == 'up':
+                self.send(key_code(argument) | RELEASED)
+            elif command == 'tap':
+                self.send(key_code(argument))
+                self.send(key_code(argument) | RELEASED)
+            elif command == 'releaseall':
+                self.send(self.last)
+            elif command == 'sleep':
+                time.sleep(int(argument) / 1000.0)
+            elif command == 'expect':
+                expected.append(argument)
+            else:
+                raise SystemExit('line %d: unknown command %r' % (number, command))
+        return expected
+
+
+def wait_for(stream, text, timeout):
+    """Reads lines from stream until one contains text."""
+    end = time.monotonic() + timeout
+    while time.monotonic() < end:
+        line = stream.readline()
+        if not line:
+            break
+        sys.stderr.write(line)
+        if text in line:
+            return
+    raise SystemExit('ppkd did not report %r' % text)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument('--script', required=True, type=argparse.FileType('r'), help='keys to type')
+    parser.add_argument('command', nargs=argparse.REMAINDER, help='ppkd command line, {tty} is replaced')
+    args = parser.parse_args()
+    command = args.command[1:] if args.command[:1] == ['--'] else args.command
+
+    master, slave = os.openpty()
+    tty.setraw(master)
+    path = os.ttyname(slave)
+    keyboard = Keyboard(master)
+    script = args.script.readlines()
+
+    if not command:
+        print('keyboard on %s, start ppkd --no-modem %s and press enter' % (path, path))
+        sys.stdin.readline()
+        os.write(master, ID)
+        time.sleep(0.1)
+        keyboard.run(script)
+        return
+
+    # ppkd only reads the id once it has booted the keyboard, until then it waits in the terminal
+    daemon = subprocess.Popen([part.replace('{tty}', path) for part in command],
+                              stdout=subprocess.PIPE, stderr=subprocess.PIPE, universal_newlines=True)
+    os.write(master, ID)
+    wait_for(daemon.stderr, 'keyboard ready', 5.0)
+
+    expected = keyboard.run(script)
+    time.sleep(0.1)
+    daemon.terminate()
+    output, errors = daemon.communicate()
+    sys.stderr.write(errors)
+    os.close(master)
+    os.close(slave)
+
+    printed = output.splitlines()
+    for number, (want, got) in enumerate(zip(expected, printed), 1):
+        if want != got:
+            raise SystemExit('event %d: expected %r, ppkd printed %r' % (number, want, got))
+    if len(printed) != len(expected):
+        raise SystemExit('expected %d events, ppkd printed %d' % (len(expected), len(printed)))
+    print('%d events as expected' % len(expected))
+
+
+if __name__ == '__main__':
+    main()
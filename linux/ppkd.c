@@ -0,0 +1,485 @@
+/** \file
+ *
+ *  Linux driver for a Palm Portable Keyboard wired to a serial port (a USB serial adapter or the
+ *  UART of a single board computer), as an alternative to the USB firmware in ../src. It runs the
+ *  same boot handshake (../src/KeyboardLink.c) and key mapping (../src/KeyMap.c) and hands the
+ *  keys to the input layer through uinput, without the hop over USB polling.
+ *
+ *  The keyboard's DCD and RTS go to the port's DCD and RTS, its supply may be switched by DTR.
+ *  The tty is read in raw mode with the low latency flag set, which makes USB serial adapters
+ *  pass on every byte right away.
+ *
+ *    ppkd /dev/ttyUSB0
+ *    ppkd --no-modem --print /dev/pts/3     without modem lines, printing the key events
+ *
+ *  See ppk_emulator.py for testing through a pseudo terminal.
+ */
+
+#define _DEFAULT_SOURCE
+
+#include <errno.h>
+#include <fcntl.h>
+#include <getopt.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <linux/serial.h>
+#include <linux/uinput.h>
+
+#include "KeyMap.h"
+#include "KeyboardLink.h"
+
+/** Wait between runs of the link task while the keyboard boots, in milliseconds. */
+#define BOOT_POLL_MS   1
+
+/** Wait between runs of the link task while the keyboard is up, DCD is supervised at this rate. */
+#define READY_POLL_MS  10
+
+/** Linux key code and name of a HID usage, the same assignment as the kernel's hid-input. */
+typedef struct
+{
+  uint16_t Code;
+  const char* Name;
+} KeyName_t;
+
+#define KEY_NAME(usage, code) [usage] = { code, #code }
+
+static const KeyName_t UsageKeys[256] =
+  {
+    KEY_NAME(HID_KEYBOARD_SC_A, KEY_A), KEY_NAME(HID_KEYBOARD_SC_B, KEY_B),
+    KEY_NAME(HID_KEYBOARD_SC_C, KEY_C), KEY_NAME(HID_KEYBOARD_SC_D, KEY_D),
+    KEY_NAME(HID_KEYBOARD_SC_E, KEY_E), KEY_NAME(HID_KEYBOARD_SC_F, KEY_F),
+    KEY_NAME(HID_KEYBOARD_SC_G, KEY_G), KEY_NAME(HID_KEYBOARD_SC_H, KEY_H),
+    KEY_NAME(HID_KEYBOARD_SC_I, KEY_I), KEY_NAME(HID_KEYBOARD_SC_J, KEY_J),
+    KEY_NAME(HID_KEYBOARD_SC_K, KEY_K), KEY_NAME(HID_KEYBOARD_SC_L, KEY_L),
+    KEY_NAME(HID_KEYBOARD_SC_M, KEY_M), KEY_NAME(HID_KEYBOARD_SC_N, KEY_N),
+    KEY_NAME(HID_KEYBOARD_SC_O, KEY_O), KEY_NAME(HID_KEYBOARD_SC_P, KEY_P),
+    KEY_NAME(HID_KEYBOARD_SC_Q, KEY_Q), KEY_NAME(HID_KEYBOARD_SC_R, KEY_R),
+    KEY_NAME(HID_KEYBOARD_SC_S, KEY_S), KEY_NAME(HID_KEYBOARD_SC_T, KEY_T),
+    KEY_NAME(HID_KEYBOARD_SC_U, KEY_U), KEY_NAME(HID_KEYBOARD_SC_V, KEY_V),
+    KEY_NAME(HID_KEYBOARD_SC_W, KEY_W), KEY_NAME(HID_KEYBOARD_SC_X, KEY_X),
+    KEY_NAME(HID_KEYBOARD_SC_Y, KEY_Y), KEY_NAME(HID_KEYBOARD_SC_Z, KEY_Z),
+    KEY_NAME(HID_KEYBOARD_SC_1_AND_EXCLAMATION, KEY_1),
+    KEY_NAME(HID_KEYBOARD_SC_2_AND_AT, KEY_2),
+    KEY_NAME(HID_KEYBOARD_SC_3_AND_HASHMARK, KEY_3),
+    KEY_NAME(HID_KEYBOARD_SC_4_AND_DOLLAR, KEY_4),
+    KEY_NAME(HID_KEYBOARD_SC_5_AND_PERCENTAGE, KEY_5),
+    KEY_NAME(HID_KEYBOARD_SC_6_AND_CARET, KEY_6),
+    KEY_NAME(HID_KEYBOARD_SC_7_AND_AMPERSAND, KEY_7),
+    KEY_NAME(HID_KEYBOARD_SC_8_AND_ASTERISK, KEY_8),
+    KEY_NAME(HID_KEYBOARD_SC_9_AND_OPENING_PARENTHESIS, KEY_9),
+    KEY_NAME(HID_KEYBOARD_SC_0_AND_CLOSING_PARENTHESIS, KEY_0),
+    KEY_NAME(HID_KEYBOARD_SC_ENTER, KEY_ENTER),
+    KEY_NAME(HID_KEYBOARD_SC_ESCAPE, KEY_ESC),
+    KEY_NAME(HID_KEYBOARD_SC_BACKSPACE, KEY_BACKSPACE),
+    KEY_NAME(HID_KEYBOARD_SC_TAB, KEY_TAB),
+    KEY_NAME(HID_KEYBOARD_SC_SPACE, KEY_SPACE),
+    KEY_NAME(HID_KEYBOARD_SC_MINUS_AND_UNDERSCORE, KEY_MINUS),
+    KEY_NAME(HID_KEYBOARD_SC_EQUAL_AND_PLUS, KEY_EQUAL),
+    KEY_NAME(HID_KEYBOARD_SC_OPENING_BRACKET_AND_OPENING_BRACE, KEY_LEFTBRACE),
+    KEY_NAME(HID_KEYBOARD_SC_CLOSING_BRACKET_AND_CLOSING_BRACE, KEY_RIGHTBRACE),
+    KEY_NAME(HID_KEYBOARD_SC_BACKSLASH_AND_PIPE, KEY_BACKSLASH),
+    KEY_NAME(HID_KEYBOARD_SC_SEMICOLON_AND_COLON, KEY_SEMICOLON),
+    KEY_NAME(HID_KEYBOARD_SC_APOSTROPHE_AND_QUOTE, KEY_APOSTROPHE),
+    KEY_NAME(HID_KEYBOARD_SC_GRAVE_ACCENT_AND_TILDE, KEY_GRAVE),
+    KEY_NAME(HID_KEYBOARD_SC_COMMA_AND_LESS_THAN_SIGN, KEY_COMMA),
+    KEY_NAME(HID_KEYBOARD_SC_DOT_AND_GREATER_THAN_SIGN, KEY_DOT),
+    KEY_NAME(HID_KEYBOARD_SC_SLASH_AND_QUESTION_MARK, KEY_SLASH),
+    KEY_NAME(HID_KEYBOARD_SC_CAPS_LOCK, KEY_CAPSLOCK),
+    KEY_NAME(HID_KEYBOARD_SC_F1, KEY_F1), KEY_NAME(HID_KEYBOARD_SC_F2, KEY_F2),
+    KEY_NAME(HID_KEYBOARD_SC_F3, KEY_F3), KEY_NAME(HID_KEYBOARD_SC_F4, KEY_F4),
+    KEY_NAME(HID_KEYBOARD_SC_F5, KEY_F5), KEY_NAME(HID_KEYBOARD_SC_F6, KEY_F6),
+    KEY_NAME(HID_KEYBOARD_SC_F7, KEY_F7), KEY_NAME(HID_KEYBOARD_SC_F8, KEY_F8),
+    KEY_NAME(HID_KEYBOARD_SC_F9, KEY_F9), KEY_NAME(HID_KEYBOARD_SC_F10, KEY_F10),
+    KEY_NAME(HID_KEYBOARD_SC_F11, KEY_F11), KEY_NAME(HID_KEYBOARD_SC_F12, KEY_F12),
+    KEY_NAME(HID_KEYBOARD_SC_INSERT, KEY_INSERT),
+    KEY_NAME(HID_KEYBOARD_SC_HOME, KEY_HOME),
+    KEY_NAME(HID_KEYBOARD_SC_PAGE_UP, KEY_PAGEUP),
+    KEY_NAME(HID_KEYBOARD_SC_DELETE, KEY_DELETE),
+    KEY_NAME(HID_KEYBOARD_SC_END, KEY_END),
+    KEY_NAME(HID_KEYBOARD_SC_PAGE_DOWN, KEY_PAGEDOWN),
+    KEY_NAME(HID_KEYBOARD_SC_RIGHT_ARROW, KEY_RIGHT),
+    KEY_NAME(HID_KEYBOARD_SC_LEFT_ARROW, KEY_LEFT),
+    KEY_NAME(HID_KEYBOARD_SC_DOWN_ARROW, KEY_DOWN),
+    KEY_NAME(HID_KEYBOARD_SC_UP_ARROW, KEY_UP),
+    KEY_NAME(HID_KEYBOARD_SC_NON_US_BACKSLASH_AND_PIPE, KEY_102ND),
+    KEY_NAME(HID_KEYBOARD_SC_LEFT_GUI, KEY_LEFTMETA),
+    KEY_NAME(HID_KEYBOARD_SC_MEDIA_PREVIOUS_TRACK, KEY_PREVIOUSSONG),
+    KEY_NAME(HID_KEYBOARD_SC_MEDIA_NEXT_TRACK, KEY_NEXTSONG),
+    KEY_NAME(HID_KEYBOARD_SC_MEDIA_VOLUME_UP, KEY_VOLUMEUP),
+    KEY_NAME(HID_KEYBOARD_SC_MEDIA_VOLUME_DOWN, KEY_VOLUMEDOWN),
+  };
+
+/** Linux key codes of the modifier bits of the report, lowest bit first. */
+static const KeyName_t ModifierKeys[8] =
+  {
+    { KEY_LEFTCTRL, "KEY_LEFTCTRL" }, { KEY_LEFTSHIFT, "KEY_LEFTSHIFT" },
+    { KEY_LEFTALT, "KEY_LEFTALT" }, { KEY_LEFTMETA, "KEY_LEFTMETA" },
+    { KEY_RIGHTCTRL, "KEY_RIGHTCTRL" }, { KEY_RIGHTSHIFT, "KEY_RIGHTSHIFT" },
+    { KEY_RIGHTALT, "KEY_RIGHTALT" }, { KEY_RIGHTMETA, "KEY_RIGHTMETA" },
+  };
+
+/** serial keyboard protocols, told apart by the id string sent after power up */
+static const struct
+{
+  uint8_t ID[2];
+  KeyMap_Handler_t ProcessByte;
+} KeyboardDrivers[] =
+  {
+    { .ID = {KEYMAP_PALM_PORTABLE_ID0, KEYMAP_PALM_PORTABLE_ID1}, .ProcessByte = PalmPortable_ProcessByte },
+  };
+
+static struct
+{
+  int Tty;                      //!< serial port of the keyboard
+  int Uinput;                   //!< uinput device, or -1 if events are printed
+  bool NoModem;                 //!< port without modem lines (e.g. a pseudo terminal), DCD is taken as high
+  bool Verbose;                 //!< log the boot handshake
+
+  bool RTS;                     //!< RTS as last set, for ports without modem lines
+  uint8_t Id[2];                //!< id string as received
+  uint8_t IdBytes;              //!< bytes of the id string received, saturating
+
+  KeyboardLink_t Link;
+  KeyMap_t KeyMap;
+  KeyMap_Handler_t ProcessByte;
+  bool Down[KEY_CNT];           //!< keys the input layer has been told to be down
+} Driver = { .Tty = -1, .Uinput = -1 };
+
+static void Fail(const char* What)
+{
+  fprintf(stderr, "ppkd: %s: %s\n", What, strerror(errno));
+  exit(EXIT_FAILURE);
+}
+
+/** monotonic millisecond clock for the link timing */
+static uint32_t Milliseconds(void)
+{
+  struct timespec now;
+
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (uint32_t)(now.tv_sec * 1000 + now.tv_nsec / 1000000);
+}
+
+static void SetModemLine(const int Line, const bool High)
+{
+  if (ioctl(Driver.Tty, High ? TIOCMBIS : TIOCMBIC, &Line) < 0)
+    Fail("setting modem lines");
+}
+
+static int GetModemLines(void)
+{
+  int lines;
+
+  if (ioctl(Driver.Tty, TIOCMGET, &lines) < 0)
+    Fail("reading modem lines");
+  return lines;
+}
+
+/* lines to the keyboard, for KeyboardLink.c */
+
+/** switches the keyboard's supply through DTR, a keyboard powered otherwise just misses the power cycle */
+void KeyboardPort_SetPower(const bool On)
+{
+  if (!Driver.NoModem)
+    SetModemLine(TIOCM_DTR, On);
+}
+
+bool KeyboardPort_GetDCD(void)
+{
+  return Driver.NoModem || (GetModemLines() & TIOCM_CAR);
+}
+
+bool KeyboardPort_GetRTS(void)
+{
+  return Driver.NoModem ? Driver.RTS : (GetModemLines() & TIOCM_RTS);
+}
+
+void KeyboardPort_SetRTS(const bool High)
+{
+  Driver.RTS = High;
+  if (!Driver.NoModem)
+    SetModemLine(TIOCM_RTS, High);
+}
+
+/** an RS-232 line cannot be tri-stated, RTS is deasserted instead */
+void KeyboardPort_ReleaseRTS(void)
+{
+  KeyboardPort_SetRTS(false);
+}
+
+/** drops what the keyboard sent while powering up, unless there are no modem lines to boot it with */
+void KeyboardPort_StartId(void)
+{
+  Driver.IdBytes = 0;
+  if (!Driver.NoModem)
+    tcflush(Driver.Tty, TCIFLUSH);
+  if (Driver.Verbose)
+    fprintf(stderr, "ppkd: waiting for the keyboard id\n");
+}
+
+uint8_t KeyboardPort_IdProgress(void)
+{
+  return Driver.IdBytes;
+}
+
+void KeyboardPort_FinishId(void)
+{
+}
+
+/** picks the driver matching the received id string, falls back to the first one for unknown keyboards */
+static void SelectKeyboardDriver(void)
+{
+  Driver.ProcessByte = KeyboardDrivers[0].ProcessByte;
+  for (size_t i = 0; i < sizeof(KeyboardDrivers) / sizeof(KeyboardDrivers[0]); i++)
+    {
+      if ((Driver.IdBytes >= 2) && !memcmp(Driver.Id, KeyboardDrivers[i].ID, 2))
+	{
+	  Driver.ProcessByte = KeyboardDrivers[i].ProcessByte;
+	  break;
+	}
+    }
+
+  fprintf(stderr, "ppkd: keyboard ready, id %02x %02x\n", Driver.Id[0], Driver.Id[1]);
+}
+
+static void WriteEvent(const uint16_t Type, const uint16_t Code, const int32_t Value)
+{
+  struct input_event event = { .type = Type, .code = Code, .value = Value };
+
+  if (write(Driver.Uinput, &event, sizeof(event)) != sizeof(event))
+    Fail("writing to uinput");
+}
+
+/** tells the input layer about a key going up or down, unless it already knows */
+static bool SetKey(const KeyName_t* const Key, const bool Down)
+{
+  if (!Key->Code || (Driver.Down[Key->Code] == Down))
+    return false;
+
+  Driver.Down[Key->Code] = Down;
+  if (Driver.Uinput < 0)
+    printf("%s %s\n", Down ? "press" : "release", Key->Name);
+  else
+    WriteEvent(EV_KEY, Key->Code, Down);
+  return true;
+}
+
+/** passes the changes of the keyboard report on to the input layer, releases first */
+static void EmitReport(void)
+{
+  bool down[KEY_CNT] = { false };
+  bool changed = false;
+
+  for (uint8_t bit = 0; bit < 8; bit++)
+    {
+      if (Driver.KeyMap.Report.Modifier & (1 << bit))
+	down[ModifierKeys[bit].Code] = true;
+    }
+  for (uint8_t i = 0; i < Driver.KeyMap.UsedKeyCodes; i++)
+    down[UsageKeys[Driver.KeyMap.Report.KeyCode[i]].Code] = true;
+
+  for (uint8_t bit = 0; bit < 8; bit++)
+    changed |= (!down[ModifierKeys[bit].Code] && SetKey(&ModifierKeys[bit], false));
+  for (unsigned usage = 0; usage < 256; usage++)
+    changed |= (!down[UsageKeys[usage].Code] && SetKey(&UsageKeys[usage], false));
+
+  for (uint8_t bit = 0; bit < 8; bit++)
+    changed |= (down[ModifierKeys[bit].Code] && SetKey(&ModifierKeys[bit], true));
+  for (uint8_t i = 0; i < Driver.KeyMap.UsedKeyCodes; i++)
+    changed |= SetKey(&UsageKeys[Driver.KeyMap.Report.KeyCode[i]], true);
+
+  if (!changed)
+    return;
+
+  if (Driver.Uinput < 0)
+    fflush(stdout);
+  else
+    WriteEvent(EV_SYN, SYN_REPORT, 0);
+}
+
+/** raw mode at the keyboard's baudrate, ignoring DCD for the tty itself so that it never hangs up */
+static void SetupTty(const char* Path, const speed_t Speed)
+{
+  struct termios tio;
+  struct serial_struct serial;
+
+  Driver.Tty = open(Path, O_RDWR | O_NOCTTY | O_NONBLOCK);
+  if (Driver.Tty < 0)
+    Fail(Path);
+
+  if (tcgetattr(Driver.Tty, &tio) < 0)
+    Fail("reading the tty settings");
+  cfmakeraw(&tio);
+  cfsetispeed(&tio, Speed);
+  cfsetospeed(&tio, Speed);
+  tio.c_cflag |= CLOCAL | CREAD;
+  tio.c_cflag &= ~(CRTSCTS | HUPCL);
+  tio.c_cc[VMIN] = 1;
+  tio.c_cc[VTIME] = 0;
+  if (tcsetattr(Driver.Tty, TCSANOW, &tio) < 0)
+    Fail("setting up the tty");
+
+  // hand every byte over right away, e.g. the latency timer of FTDI adapters goes to 1ms
+  if (ioctl(Driver.Tty, TIOCGSERIAL, &serial) == 0)
+    {
+      serial.flags |= ASYNC_LOW_LATENCY;
+      ioctl(Driver.Tty, TIOCSSERIAL, &serial);
+    }
+}
+
+static void SetupUinput(void)
+{
+  struct uinput_setup setup = { .id = { .bustype = BUS_RS232 } };
+
+  strcpy(setup.name, "Palm Portable Keyboard");
+
+  Driver.Uinput = open("/dev/uinput", O_WRONLY | O_NONBLOCK);
+  if (Driver.Uinput < 0)
+    Fail("/dev/uinput");
+
+  // the input layer generates the autorepeat, as for USB keyboards
+  if ((ioctl(Driver.Uinput, UI_SET_EVBIT, EV_KEY) < 0) ||
+      (ioctl(Driver.Uinput, UI_SET_EVBIT, EV_SYN) < 0) ||
+      (ioctl(Driver.Uinput, UI_SET_EVBIT, EV_REP) < 0))
+    Fail("setting up uinput");
+
+  for (unsigned usage = 0; usage < 256; usage++)
+    {
+      if (UsageKeys[usage].Code)
+	ioctl(Driver.Uinput, UI_SET_KEYBIT, UsageKeys[usage].Code);
+    }
+  for (uint8_t bit = 0; bit < 8; bit++)
+    ioctl(Driver.Uinput, UI_SET_KEYBIT, ModifierKeys[bit].Code);
+
+  if ((ioctl(Driver.Uinput, UI_DEV_SETUP, &setup) < 0) ||
+      (ioctl(Driver.Uinput, UI_DEV_CREATE) < 0))
+    Fail("creating the uinput device");
+}
+
+/** reads what the keyboard sent, the id string while booting and key bytes once it is ready */
+static void ReadTty(void)
+{
+  uint8_t buffer[64];
+  ssize_t received = read(Driver.Tty, buffer, sizeof(buffer));
+
+  if ((received < 0) && (errno == EAGAIN))
+    return;
+  if (received < 0)
+    Fail("reading the tty");
+  if (received == 0)
+    {
+      fprintf(stderr, "ppkd: tty closed\n");
+      exit(EXIT_SUCCESS);
+    }
+
+  for (ssize_t i = 0; i < received; i++)
+    {
+      if (KeyboardLink_Ready(&Driver.Link))
+	{
+	  KeyboardLink_ByteReceived(&Driver.Link, Milliseconds());
+	  Driver.ProcessByte(&Driver.KeyMap, buffer[i]);
+	  EmitReport();
+	}
+      else
+	{
+	  if (Driver.IdBytes < sizeof(Driver.Id))
+	    Driver.Id[Driver.IdBytes] = buffer[i];
+	  if (Driver.IdBytes < UINT8_MAX)
+	    Driver.IdBytes++;
+	}
+    }
+}
+
+static void Usage(const char* Name)
+{
+  fprintf(stderr,
+	  "usage: %s [options] TTY\n"
+	  "  -b, --baud N      baudrate of the keyboard (9600)\n"
+	  "  -n, --no-modem    the port has no modem lines, e.g. a pseudo terminal\n"
+	  "  -p, --print       print the key events instead of creating a uinput device\n"
+	  "  -v, --verbose     log the boot handshake\n", Name);
+  exit(EXIT_FAILURE);
+}
+
+int main(int argc, char* argv[])
+{
+  static const struct option options[] =
+    {
+      { "baud",     required_argument, NULL, 'b' },
+      { "no-modem", no_argument,       NULL, 'n' },
+      { "print",    no_argument,       NULL, 'p' },
+      { "verbose",  no_argument,       NULL, 'v' },
+      { NULL, 0, NULL, 0 },
+    };
+  speed_t speed = B9600;
+  bool print = false;
+  int option;
+
+  while ((option = getopt_long(argc, argv, "b:npv", options, NULL)) != -1)
+    {
+      switch (option)
+	{
+	case 'b':
+	  switch (atoi(optarg))
+	    {
+	    case 4800:  speed = B4800;  break;
+	    case 9600:  speed = B9600;  break;
+	    case 19200: speed = B19200; break;
+	    default:    Usage(argv[0]);
+	    }
+	  break;
+	case 'n': Driver.NoModem = true; break;
+	case 'p': print = true;          break;
+	case 'v': Driver.Verbose = true; break;
+	default:  Usage(argv[0]);
+	}
+    }
+  if (optind != argc - 1)
+    Usage(argv[0]);
+
+  SetupTty(argv[optind], speed);
+  if (!print)
+    SetupUinput();
+
+  KeyboardLink_Boot(&Driver.Link, Milliseconds());
+
+  for (;;)
+    {
+      switch (KeyboardLink_Task(&Driver.Link, Milliseconds()))
+	{
+	case LINK_EVENT_READY:
+	  SelectKeyboardDriver();
+	  break;
+	case LINK_EVENT_LOST:
+	  fprintf(stderr, "ppkd: keyboard lost, booting it again\n");
+	  KeyMap_ReleaseAll(&Driver.KeyMap);
+	  EmitReport();
+	  break;
+	default:
+	  break;
+	}
+
+      bool ready = KeyboardLink_Ready(&Driver.Link);
+      if (ready)
+	KeyboardLink_KeepAwakeTask(&Driver.Link, Milliseconds());
+
+      // bytes are only taken while the link expects them, before that they wait in the tty
+      struct pollfd tty = { .fd = Driver.Tty, .events = POLLIN };
+      bool reading = ready || (Driver.Link.State == LINK_WAIT_ID);
+
+      if (poll(&tty, reading ? 1 : 0, ready ? READY_POLL_MS : BOOT_POLL_MS) < 0)
+	{
+	  if (errno != EINTR)
+	    Fail("poll");
+	  continue;
+	}
+      if (tty.revents)
+	ReadTty();
+    }
+}
@@ -0,0 +1,53 @@
+/** \file
+ *
+ *  Compile time options of the application. Each can be overridden from the make command
+ *  line, e.g. "make TYPING_STATS=1", which the makefile passes on to the compiler.
+ */
+
+#ifndef _APP_CONFIG_H_
+#define _APP_CONFIG_H_
+
+	/** Default baudrate of the keyboard's serial line, until a calibration measures the actual one.
+	 *  Together with F_CPU it selects the Timer1 prescaler, see Timer.h.
+	 */
+	#if !defined(BAUDRATE)
+		#define BAUDRATE              9600
+	#endif
+
+	/** Non-zero to keep typing statistics on the device, see TypingStats.h. This adds a vendor
+	 *  specific HID interface next to the keyboard and about 400 bytes of RAM.
+	 */
+	#if !defined(TYPING_STATS)
+		#define TYPING_STATS          0
+	#endif
+
+	/** Non-zero to timestamp every keyboard byte on its way through the firmware, see LatencyProbe.h.
+	 *  This adds the vendor specific HID interface and a few timer reads per byte.
+	 */
+	#if !defined(LATENCY_PROBE)
+		#define LATENCY_PROBE         0
+	#endif
+
+	/** Non-zero to let host software receive the raw key events of the keyboard, see RawEvents.h.
+	 *  This adds the vendor specific HID interface, the keyboard interface stays as it is.
+	 */
+	#if !defined(RAW_EVENTS)
+		#define RAW_EVENTS            0
+	#endif
+
+	/** Non-zero to record the USB transactions of the device for a pcap file, see UsbTrace.h. This
+	 *  adds the vendor specific HID interface and about 500 bytes of RAM.
+	 */
+	#if !defined(USB_TRACE)
+		#define USB_TRACE             0
+	#endif
+
+	/** Non-zero if the device has the vendor specific HID interface next to the keyboard, which
+	 *  carries the reports of the optional features above.
+	 */
+	#define VENDOR_INTERFACE          (TYPING_STATS || LATENCY_PROBE || RAW_EVENTS || USB_TRACE)
+
+	/** Non-zero if the software UART keeps the reception times of each byte. */
+	#define SWUART_FRAME_TIMES        (LATENCY_PROBE || RAW_EVENTS)
+
+#endif
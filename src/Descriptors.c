@@ -36,6 +36,10 @@
  */
 
 #include "Descriptors.h"
+#include "TypingStats.h"
+#include "LatencyProbe.h"
+#include "RawEvents.h"
+#include "UsbTrace.h"
 
 /** HID class report descriptor. This is a special descriptor constructed with values from the
  *  USBIF HID class specification to describe the reports and capabilities of the HID device. This
@@ -51,6 +55,62 @@ const USB_Descriptor_HIDReport_Datatype_t PROGMEM KeyboardReport[] =
 	HID_DESCRIPTOR_KEYBOARD(6)
 };
 
+#if (VENDOR_INTERFACE)
+/** HID class report descriptor of the vendor specific interface. Its reports are opaque bytes to
+ *  the host's HID stack, they are meant for the tools in the tools/ directory (e.g. through hidraw).
+ */
+const USB_Descriptor_HIDReport_Datatype_t PROGMEM VendorReport[] =
+{
+	HID_RI_USAGE_PAGE(16, 0xFF00), /* Vendor Page 0 */
+	HID_RI_USAGE(8, 0x01), /* Vendor Usage 1 */
+	HID_RI_COLLECTION(8, 0x01), /* Application */
+		HID_RI_LOGICAL_MINIMUM(8, 0x00),
+		HID_RI_LOGICAL_MAXIMUM(16, 0x00FF),
+		HID_RI_REPORT_SIZE(8, 0x08),
+
+	#if (TYPING_STATS)
+		HID_RI_REPORT_ID(8, TYPING_STATS_REPORTID_Histograms),
+		HID_RI_USAGE(8, 0x02), /* Vendor Usage 2 */
+		HID_RI_REPORT_COUNT(8, sizeof(TypingStats_Histograms_t) - 1),
+		HID_RI_FEATURE(8, HID_IOF_DATA | HID_IOF_VARIABLE | HID_IOF_ABSOLUTE),
+
+		HID_RI_REPORT_ID(8, TYPING_STATS_REPORTID_PressCountsLow),
+		HID_RI_USAGE(8, 0x03), /* Vendor Usage 3 */
+		HID_RI_REPORT_COUNT(8, sizeof(TypingStats_PressCounts_t) - 1),
+		HID_RI_FEATURE(8, HID_IOF_DATA | HID_IOF_VARIABLE | HID_IOF_ABSOLUTE),
+
+		HID_RI_REPORT_ID(8, TYPING_STATS_REPORTID_PressCountsHigh),
+		HID_RI_USAGE(8, 0x03), /* Vendor Usage 3 */
+		HID_RI_REPORT_COUNT(8, sizeof(TypingStats_PressCounts_t) - 1),
+		HID_RI_FEATURE(8, HID_IOF_DATA | HID_IOF_VARIABLE | HID_IOF_ABSOLUTE),
+	#endif
+	#if (LATENCY_PROBE)
+		HID_RI_REPORT_ID(8, LATENCY_PROBE_REPORTID),
+		HID_RI_USAGE(8, 0x04), /* Vendor Usage 4 */
+		HID_RI_REPORT_COUNT(8, sizeof(LatencyProbe_Report_t) - 1),
+		HID_RI_FEATURE(8, HID_IOF_DATA | HID_IOF_VARIABLE | HID_IOF_ABSOLUTE),
+	#endif
+	#if (RAW_EVENTS)
+		HID_RI_REPORT_ID(8, RAW_EVENTS_REPORTID_Events),
+		HID_RI_USAGE(8, 0x05), /* Vendor Usage 5 */
+		HID_RI_REPORT_COUNT(8, sizeof(RawEvents_Report_t) - 1),
+		HID_RI_INPUT(8, HID_IOF_DATA | HID_IOF_VARIABLE | HID_IOF_ABSOLUTE),
+
+		HID_RI_REPORT_ID(8, RAW_EVENTS_REPORTID_Mode),
+		HID_RI_USAGE(8, 0x06), /* Vendor Usage 6 */
+		HID_RI_REPORT_COUNT(8, 1),
+		HID_RI_FEATURE(8, HID_IOF_DATA | HID_IOF_VARIABLE | HID_IOF_ABSOLUTE),
+	#endif
+	#if (USB_TRACE)
+		HID_RI_REPORT_ID(8, USB_TRACE_REPORTID),
+		HID_RI_USAGE(8, 0x07), /* Vendor Usage 7 */
+		HID_RI_REPORT_COUNT(8, sizeof(UsbTrace_Report_t) - 1),
+		HID_RI_FEATURE(8, HID_IOF_DATA | HID_IOF_VARIABLE | HID_IOF_ABSOLUTE),
+	#endif
+	HID_RI_END_COLLECTION(0),
+};
+#endif
+
 /** Device descriptor structure. This descriptor, located in FLASH memory, describes the overall
  *  device characteristics, including the supported USB version, control endpoint size and the
  *  number of device configurations. The descriptor is read out by the USB host when the enumeration
@@ -90,7 +150,7 @@ const USB_Descriptor_Configuration_t PROGMEM ConfigurationDescriptor =
 			.Header                 = {.Size = sizeof(USB_Descriptor_Configuration_Header_t), .Type = DTYPE_Configuration},
 
 			.TotalConfigurationSize = sizeof(USB_Descriptor_Configuration_t),
-			.TotalInterfaces        = 1,
+			.TotalInterfaces        = (VENDOR_INTERFACE ? 2 : 1),
 
 			.ConfigurationNumber    = 1,
 			.ConfigurationStrIndex  = NO_DESCRIPTOR,
@@ -136,6 +196,45 @@ const USB_Descriptor_Configuration_t PROGMEM ConfigurationDescriptor =
 			.EndpointSize           = KEYBOARD_EPSIZE,
 			.PollingIntervalMS      = 0x05
 		},
+
+#if (VENDOR_INTERFACE)
+	.Vendor_Interface =
+		{
+			.Header                 = {.Size = sizeof(USB_Descriptor_Interface_t), .Type = DTYPE_Interface},
+
+			.InterfaceNumber        = INTERFACE_ID_Vendor,
+			.AlternateSetting       = 0x00,
+
+			.TotalEndpoints         = 1,
+
+			.Class                  = HID_CSCP_HIDClass,
+			.SubClass               = HID_CSCP_NonBootSubclass,
+			.Protocol               = HID_CSCP_NonBootProtocol,
+
+			.InterfaceStrIndex      = NO_DESCRIPTOR
+		},
+
+	.Vendor_HID =
+		{
+			.Header                 = {.Size = sizeof(USB_HID_Descriptor_HID_t), .Type = HID_DTYPE_HID},
+
+			.HIDSpec                = VERSION_BCD(1,1,1),
+			.CountryCode            = 0x00,
+			.TotalReportDescriptors = 1,
+			.HIDReportType          = HID_DTYPE_Report,
+			.HIDReportLength        = sizeof(VendorReport)
+		},
+
+	.Vendor_ReportINEndpoint =
+		{
+			.Header                 = {.Size = sizeof(USB_Descriptor_Endpoint_t), .Type = DTYPE_Endpoint},
+
+			.EndpointAddress        = VENDOR_EPADDR,
+			.Attributes             = (EP_TYPE_INTERRUPT | ENDPOINT_ATTR_NO_SYNC | ENDPOINT_USAGE_DATA),
+			.EndpointSize           = VENDOR_EPSIZE,
+			.PollingIntervalMS      = 0x01
+		},
+#endif
 };
 
 /** Language descriptor structure. This descriptor, located in FLASH memory, is returned when the host requests
@@ -201,15 +300,39 @@ uint16_t CALLBACK_USB_GetDescriptor(const uint16_t wValue,
 
 			break;
 		case HID_DTYPE_HID:
-			Address = &ConfigurationDescriptor.HID_KeyboardHID;
-			Size    = sizeof(USB_HID_Descriptor_HID_t);
+			if (wIndex == INTERFACE_ID_Keyboard)
+			{
+				Address = &ConfigurationDescriptor.HID_KeyboardHID;
+				Size    = sizeof(USB_HID_Descriptor_HID_t);
+			}
+#if (VENDOR_INTERFACE)
+			else if (wIndex == INTERFACE_ID_Vendor)
+			{
+				Address = &ConfigurationDescriptor.Vendor_HID;
+				Size    = sizeof(USB_HID_Descriptor_HID_t);
+			}
+#endif
+
 			break;
 		case HID_DTYPE_Report:
-			Address = &KeyboardReport;
-			Size    = sizeof(KeyboardReport);
+			if (wIndex == INTERFACE_ID_Keyboard)
+			{
+				Address = &KeyboardReport;
+				Size    = sizeof(KeyboardReport);
+			}
+#if (VENDOR_INTERFACE)
+			else if (wIndex == INTERFACE_ID_Vendor)
+			{
+				Address = &VendorReport;
+				Size    = sizeof(VendorReport);
+			}
+#endif
+
 			break;
 	}
 
+	UsbTrace_Descriptor(Size);
+
 	*DescriptorAddress = Address;
 	return Size;
 }
@@ -41,6 +41,8 @@
 
 		#include <LUFA/Drivers/USB/USB.h>
 
+		#include "Config/AppConfig.h"
+
 	/* Type Defines: */
 		/** Type define for the device configuration descriptor structure. This must be defined in the
 		 *  application code, as the configuration descriptor contains several sub-descriptors which
@@ -54,6 +56,13 @@
 			USB_Descriptor_Interface_t            HID_Interface;
 			USB_HID_Descriptor_HID_t              HID_KeyboardHID;
 			USB_Descriptor_Endpoint_t             HID_ReportINEndpoint;
+
+#if (VENDOR_INTERFACE)
+			// Vendor Specific HID Interface
+			USB_Descriptor_Interface_t            Vendor_Interface;
+			USB_HID_Descriptor_HID_t              Vendor_HID;
+			USB_Descriptor_Endpoint_t             Vendor_ReportINEndpoint;
+#endif
 		} USB_Descriptor_Configuration_t;
 
 		/** Enum for the device interface descriptor IDs within the device. Each interface descriptor
@@ -63,6 +72,7 @@
 		enum InterfaceDescriptors_t
 		{
 			INTERFACE_ID_Keyboard = 0, /**< Keyboard interface descriptor ID */
+			INTERFACE_ID_Vendor   = 1, /**< Vendor specific HID interface descriptor ID, only present with VENDOR_INTERFACE */
 		};
 
 		/** Enum for the device string descriptor IDs within the device. Each string descriptor should
@@ -83,6 +93,12 @@
 		/** Size in bytes of the Keyboard HID reporting IN endpoint. */
 		#define KEYBOARD_EPSIZE              8
 
+		/** Endpoint address of the vendor specific HID interface's IN endpoint. */
+		#define VENDOR_EPADDR                (ENDPOINT_DIR_IN | 2)
+
+		/** Size in bytes of the vendor specific HID interface's IN endpoint. */
+		#define VENDOR_EPSIZE                64
+
 	/* Function Prototypes: */
 		uint16_t CALLBACK_USB_GetDescriptor(const uint16_t wValue,
 		                                    const uint8_t wIndex,
@@ -0,0 +1,394 @@
+/** \file
+ *
+ *  Key mapping of the serial keyboards, turns the bytes they send into a USB keyboard report.
+ *  Nothing in here touches the hardware, see KeyMap.h.
+ */
+
+#include <string.h>
+
+#include "KeyMap.h"
+
+/** press a normal key (e.g. not a modifier key) */
+static void pressKey(KeyMap_t* const KeyMap, uint8_t raw, uint8_t key)
+{
+  uint8_t used = KeyMap->UsedKeyCodes;
+
+  if (used < 6)
+    {
+      KeyMap->PressedRaw[used] = raw;
+      KeyMap->Report.KeyCode[used] = key;
+      KeyMap->UsedKeyCodes = used + 1;
+    }
+}
+
+/** release all keys, including modifiers and FN
+ *
+ * FN is cleared as well, which the original release all code did not: after a keyboard that died
+ * with FN held, or a lost FN release byte, every later key would be mapped as its FN variant until
+ * FN was pressed and released again.
+ */
+void KeyMap_ReleaseAll(KeyMap_t* const KeyMap)
+{
+  memset(&KeyMap->Report, 0, sizeof(KeyMap->Report));
+  KeyMap->UsedKeyCodes = 0;
+  KeyMap->FNPressed = false;
+}
+
+  /** release a normal, non-modifier key */
+static void releaseKey(KeyMap_t* const KeyMap, uint8_t raw)
+{
+  uint8_t used = KeyMap->UsedKeyCodes;
+
+  // check which of the pressed KeyCode has been released
+  for (uint8_t i = 0; i < used; i++)
+    {
+      if (KeyMap->PressedRaw[i] == raw)
+	{
+	  // move remaining one place up
+	  used--;
+	  for (uint8_t j = i; j < used; j++)
+	    {
+	      KeyMap->Report.KeyCode[j] = KeyMap->Report.KeyCode[j+1];
+	      KeyMap->PressedRaw[j] = KeyMap->PressedRaw[j+1];
+	    }
+	  // and put an empty in the last place
+	  KeyMap->Report.KeyCode[used] = 0;
+	  KeyMap->UsedKeyCodes = used;
+	  break;
+	}
+    }
+}
+
+/** key mapping of the Palm Portable Keyboard */
+void PalmPortable_ProcessByte(KeyMap_t* const KeyMap, const uint8_t data)
+{
+	      unsigned char keyUpDown = data & 0b10000000;
+	      unsigned char keyXY = data & 0b01111111;
+
+	      // for a table of available keycode defines see:
+	      // LUFA/Drivers/USB/Class/Common/HIDClassCommon.h
+
+	      if (keyUpDown) // true: key released
+		{
+		if (KeyMap->LastByte == data)
+		  {
+		    KeyMap_ReleaseAll(KeyMap);
+		  }
+		else
+		  {
+		    switch (keyXY)
+		      {
+		      case 0b00100010: // FN
+			KeyMap->FNPressed = false;
+			break;
+		      case 0b00001000: // "CMD"
+			releaseKey(KeyMap, keyXY);
+			// TODO: is it okay to set the modifier flag and press the key at the same time?
+			KeyMap->Report.Modifier &= ~HID_KEYBOARD_MODIFIER_LEFTGUI;
+			break;
+		      case 0b00011010: // CTRL (only left one exists)
+			KeyMap->Report.Modifier &= ~HID_KEYBOARD_MODIFIER_LEFTCTRL;
+			break;
+		      case 0b00100011: // ALT (only left one exists)
+			KeyMap->Report.Modifier &= ~HID_KEYBOARD_MODIFIER_LEFTALT;
+			break;
+		      case 0b01011000: // SHIFT (L)
+			KeyMap->Report.Modifier &= ~HID_KEYBOARD_MODIFIER_LEFTSHIFT;
+			break;
+		      case 0b01011001: // SHIFT (R)
+			KeyMap->Report.Modifier &= ~HID_KEYBOARD_MODIFIER_RIGHTSHIFT;
+			break;
+		      default:
+			releaseKey(KeyMap, keyXY);
+		      }
+		  }
+		}
+	      else // key pressed
+	      switch(keyXY) {
+		// y0 row
+	      case 0b00000000: // '1'
+		if (KeyMap->FNPressed)
+		  pressKey(KeyMap, keyXY, HID_KEYBOARD_SC_F1);
+		else
+		  pressKey(KeyMap, keyXY, HID_KEYBOARD_SC_1_AND_EXCLAMATION);
+		break;
+	      case 0b00000001: // '2'
+		if (KeyMap->FNPressed)
+		  pressKey(KeyMap, keyXY, HID_KEYBOARD_SC_F2);
+		else
+		  pressKey(KeyMap, keyXY, HID_KEYBOARD_SC_2_AND_AT);
+		break;
+	      case 0b00000010: // '3'
+		if (KeyMap->FNPressed)
+		  pressKey(KeyMap, keyXY, HID_KEYBOARD_SC_F3);
+		else
+		  pressKey(KeyMap, keyXY, HID_KEYBOARD_SC_3_AND_HASHMARK);
+		break;
+	      case 0b00000011: // 'z'
+		pressKey(KeyMap, keyXY, HID_KEYBOARD_SC_Z);
+		break;
+	      case 0b00000100: // '4'
+		if (KeyMap->FNPressed)
+		  pressKey(KeyMap, keyXY, HID_KEYBOARD_SC_F4);
+		else
+		  pressKey(KeyMap, keyXY, HID_KEYBOARD_SC_4_AND_DOLLAR);
+		break;
+	      case 0b00000101: // '5'
+		if (KeyMap->FNPressed)
+		  pressKey(KeyMap, keyXY, HID_KEYBOARD_SC_F5);
+		else
+		  pressKey(KeyMap, keyXY, HID_KEYBOARD_SC_5_AND_PERCENTAGE);
+		break;
+	      case 0b00000110: // '6'
+		if (KeyMap->FNPressed)
+		  pressKey(KeyMap, keyXY, HID_KEYBOARD_SC_F6);
+		else
+		  pressKey(KeyMap, keyXY, HID_KEYBOARD_SC_6_AND_CARET);
+		break;
+	      case 0b00000111: // '7'
+		if (KeyMap->FNPressed)
+		  pressKey(KeyMap, keyXY, HID_KEYBOARD_SC_F7);
+		else
+		  pressKey(KeyMap, keyXY, HID_KEYBOARD_SC_7_AND_AMPERSAND);
+		break;
+
+		// y1 row
+	      case 0b00001000: // "CMD"
+		pressKey(KeyMap, keyXY, HID_KEYBOARD_SC_LEFT_GUI);
+// TODO: is it okay to set the modifier flag and press the key at the same time?
+		KeyMap->Report.Modifier |= HID_KEYBOARD_MODIFIER_LEFTGUI;
+		break;
+	      case 0b00001001: // 'q'
+		pressKey(KeyMap, keyXY, HID_KEYBOARD_SC_Q);
+		break;
+	      case 0b00001010: // 'w'
+		pressKey(KeyMap, keyXY, HID_KEYBOARD_SC_W);
+		break;
+	      case 0b00001011: // 'e'
+		pressKey(KeyMap, keyXY, HID_KEYBOARD_SC_E);
+		break;
+	      case 0b00001100: // 'r'
+		pressKey(KeyMap, keyXY, HID_KEYBOARD_SC_R);
+		break;
+	      case 0b00001101: // 't'
+		pressKey(KeyMap, keyXY, HID_KEYBOARD_SC_T);
+		break;
+	      case 0b00001110: // 'y'
+		pressKey(KeyMap, keyXY, HID_KEYBOARD_SC_Y);
+		break;
+	      case 0b00001111: // two right of space-bar
+		pressKey(KeyMap, keyXY, HID_KEYBOARD_SC_NON_US_BACKSLASH_AND_PIPE);  // physical row 5, 7th key
+		break;
+
+		// y2 row
+	      case 0b00010000: // 'x'
+		pressKey(KeyMap, keyXY, HID_KEYBOARD_SC_X);
+		break;
+	      case 0b00010001: // 'a'
+		pressKey(KeyMap, keyXY, HID_KEYBOARD_SC_A);
+		break;
+	      case 0b00010010: // 's'
+		pressKey(KeyMap, keyXY, HID_KEYBOARD_SC_S);
+		break;
+	      case 0b00010011: // 'd'
+		pressKey(KeyMap, keyXY, HID_KEYBOARD_SC_D);
+		break;
+	      case 0b00010100: // 'f'
+		pressKey(KeyMap, keyXY, HID_KEYBOARD_SC_F);
+		break;
+	      case 0b00010101: // 'g'
+		pressKey(KeyMap, keyXY, HID_KEYBOARD_SC_G);
+		break;
+	      case 0b00010110: // 'h'
+		pressKey(KeyMap, keyXY, HID_KEYBOARD_SC_H);
+		break;
+	      case 0b00010111: // ' ' // "Space 1"
+		pressKey(KeyMap, keyXY, HID_KEYBOARD_SC_SPACE);
+		break;
+
+		// y3 row
+	      case 0b00011000: // CAPS LK
+		pressKey(KeyMap, keyXY, HID_KEYBOARD_SC_CAPS_LOCK);
+		break;
+	      case 0b00011001: // TAB
+		pressKey(KeyMap, keyXY, HID_KEYBOARD_SC_TAB);
+		break;
+	      case 0b00011010: // CTRL (only left one exists)
+		KeyMap->Report.Modifier |= HID_KEYBOARD_MODIFIER_LEFTCTRL;
+		break;
+
+		// y4 row
+	      case 0b00100010: // FN
+		KeyMap->FNPressed = true;
+		break;
+	      case 0b00100011: // ALT (only left one exists)
+		KeyMap->Report.Modifier |= HID_KEYBOARD_MODIFIER_LEFTALT;
+		break;
+
+		// y5 row
+	      case 0b00101100: // 'c'
+		pressKey(KeyMap, keyXY, HID_KEYBOARD_SC_C);
+		break;
+	      case 0b00101101: // 'v'
+		pressKey(KeyMap, keyXY, HID_KEYBOARD_SC_V);
+		break;
+	      case 0b00101110: // 'b'
+		pressKey(KeyMap, keyXY, HID_KEYBOARD_SC_B);
+		break;
+	      case 0b00101111: // 'n'
+		pressKey(KeyMap, keyXY, HID_KEYBOARD_SC_N);
+		break;
+
+		// y6 row
+	      case 0b00110000: // '-'
+		if (KeyMap->FNPressed)
+		  pressKey(KeyMap, keyXY, HID_KEYBOARD_SC_F11);
+		else
+		  pressKey(KeyMap, keyXY, HID_KEYBOARD_SC_MINUS_AND_UNDERSCORE);
+		break;
+	      case 0b00110001: // '='
+		if (KeyMap->FNPressed)
+		  pressKey(KeyMap, keyXY, HID_KEYBOARD_SC_F12);
+		else
+		  pressKey(KeyMap, keyXY, HID_KEYBOARD_SC_EQUAL_AND_PLUS);
+		break;
+	      case 0b00110010: // BACK SP
+		pressKey(KeyMap, keyXY, HID_KEYBOARD_SC_BACKSPACE);
+		break;
+	      case 0b00110011: // "Special Function One"
+		pressKey(KeyMap, keyXY, HID_KEYBOARD_SC_MEDIA_NEXT_TRACK);
+		break;
+	      case 0b00110100: // '8'
+		if (KeyMap->FNPressed)
+		  pressKey(KeyMap, keyXY, HID_KEYBOARD_SC_F8);
+		else
+		  pressKey(KeyMap, keyXY, HID_KEYBOARD_SC_8_AND_ASTERISK);
+		break;
+	      case 0b00110101: // '9'
+		if (KeyMap->FNPressed)
+		  pressKey(KeyMap, keyXY, HID_KEYBOARD_SC_F9);
+		else
+		  pressKey(KeyMap, keyXY, HID_KEYBOARD_SC_9_AND_OPENING_PARENTHESIS);
+		break;
+	      case 0b00110110: // '0'
+		if (KeyMap->FNPressed)
+		  pressKey(KeyMap, keyXY, HID_KEYBOARD_SC_F10);
+		else
+		  pressKey(KeyMap, keyXY, HID_KEYBOARD_SC_0_AND_CLOSING_PARENTHESIS);
+		break;
+	      case 0b00110111: // "Space 2" - Note: right of space-bar
+		pressKey(KeyMap, keyXY, HID_KEYBOARD_SC_GRAVE_ACCENT_AND_TILDE); // physical row 5, 6th key
+		break;
+
+		// y7 row
+	      case 0b00111000: // '['
+		pressKey(KeyMap, keyXY, HID_KEYBOARD_SC_OPENING_BRACKET_AND_OPENING_BRACE);
+		break;
+	      case 0b00111001: // ']'
+		pressKey(KeyMap, keyXY, HID_KEYBOARD_SC_CLOSING_BRACKET_AND_CLOSING_BRACE);
+		break;
+	      case 0b00111010: // '\'
+		pressKey(KeyMap, keyXY, HID_KEYBOARD_SC_BACKSLASH_AND_PIPE);
+		break;
+	      case 0b00111011: // "Special Function Two"
+		pressKey(KeyMap, keyXY, HID_KEYBOARD_SC_MEDIA_PREVIOUS_TRACK);
+		break;
+	      case 0b00111100: // 'u'
+		pressKey(KeyMap, keyXY, HID_KEYBOARD_SC_U);
+		break;
+	      case 0b00111101: // 'i'
+		pressKey(KeyMap, keyXY, HID_KEYBOARD_SC_I);
+		break;
+	      case 0b00111110: // 'o'
+		pressKey(KeyMap, keyXY, HID_KEYBOARD_SC_O);
+		break;
+	      case 0b00111111: // 'p'
+		pressKey(KeyMap, keyXY, HID_KEYBOARD_SC_P);
+		break;
+
+		// y8 row
+	      case 0b01000000: // '''
+		pressKey(KeyMap, keyXY, HID_KEYBOARD_SC_APOSTROPHE_AND_QUOTE);
+		break;
+	      case 0b01000001: // ENTER
+		pressKey(KeyMap, keyXY, HID_KEYBOARD_SC_ENTER);
+		break;
+	      case 0b01000010: // "Special Function Three"
+		pressKey(KeyMap, keyXY, HID_KEYBOARD_SC_MEDIA_VOLUME_UP);
+		break;
+	      case 0b01000100: // 'j'
+		pressKey(KeyMap, keyXY, HID_KEYBOARD_SC_J);
+		break;
+	      case 0b01000101: // 'k'
+		pressKey(KeyMap, keyXY, HID_KEYBOARD_SC_K);
+		break;
+	      case 0b01000110: // 'l'
+		pressKey(KeyMap, keyXY, HID_KEYBOARD_SC_L);
+		break;
+	      case 0b01000111: // ';'
+		pressKey(KeyMap, keyXY, HID_KEYBOARD_SC_SEMICOLON_AND_COLON);
+		break;
+
+		// y9 row
+	      case 0b01001000: // '?'
+		pressKey(KeyMap, keyXY, HID_KEYBOARD_SC_SLASH_AND_QUESTION_MARK);
+		break;
+	      case 0b01001001: // up arrow
+		if (KeyMap->FNPressed)
+		  pressKey(KeyMap, keyXY, HID_KEYBOARD_SC_PAGE_UP);
+		else
+		  pressKey(KeyMap, keyXY, HID_KEYBOARD_SC_UP_ARROW);
+		break;
+	      case 0b01001010: // "Special Function Four"
+		pressKey(KeyMap, keyXY, HID_KEYBOARD_SC_MEDIA_VOLUME_DOWN);
+		break;
+	      case 0b01001100: // 'm'
+		pressKey(KeyMap, keyXY, HID_KEYBOARD_SC_M);
+		break;
+	      case 0b01001101: // ','
+		pressKey(KeyMap, keyXY, HID_KEYBOARD_SC_COMMA_AND_LESS_THAN_SIGN);
+		break;
+	      case 0b01001110: // '.'
+		pressKey(KeyMap, keyXY, HID_KEYBOARD_SC_DOT_AND_GREATER_THAN_SIGN);
+		break;
+	      case 0b01001111: // "DONE"
+		pressKey(KeyMap, keyXY, HID_KEYBOARD_SC_ESCAPE);
+		break;
+
+		// y10 row
+	      case 0b01010000: // DEL
+		if (KeyMap->FNPressed)
+		  pressKey(KeyMap, keyXY, HID_KEYBOARD_SC_INSERT);
+		else
+		  pressKey(KeyMap, keyXY, HID_KEYBOARD_SC_DELETE);
+		break;
+	      case 0b01010001: // left arrow
+		if (KeyMap->FNPressed)
+		  pressKey(KeyMap, keyXY, HID_KEYBOARD_SC_HOME);
+		else
+		  pressKey(KeyMap, keyXY, HID_KEYBOARD_SC_LEFT_ARROW);
+		break;
+	      case 0b01010010: // down arrow
+		if (KeyMap->FNPressed)
+		  pressKey(KeyMap, keyXY, HID_KEYBOARD_SC_PAGE_DOWN);
+		else
+		  pressKey(KeyMap, keyXY, HID_KEYBOARD_SC_DOWN_ARROW);
+		break;
+	      case 0b01010011: // right arrow
+		if (KeyMap->FNPressed)
+		  pressKey(KeyMap, keyXY, HID_KEYBOARD_SC_END);
+		else
+		  pressKey(KeyMap, keyXY, HID_KEYBOARD_SC_RIGHT_ARROW);
+		break;
+
+		// y11 row
+	      case 0b01011000: // SHIFT (L)
+		KeyMap->Report.Modifier |= HID_KEYBOARD_MODIFIER_LEFTSHIFT;
+		break;
+	      case 0b01011001: // SHIFT (R)
+		KeyMap->Report.Modifier |= HID_KEYBOARD_MODIFIER_RIGHTSHIFT;
+		break;
+	      }
+
+	      KeyMap->LastByte = data;
+}
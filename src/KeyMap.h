@@ -0,0 +1,58 @@
+/** \file
+ *
+ *  Header file for KeyMap.c.
+ *
+ *  The key mapping does not touch any hardware, it is shared by the firmware and the Linux
+ *  driver in ../linux. On AVR the HID usage codes and the report layout come from LUFA, elsewhere
+ *  from HidUsages.h of the respective platform.
+ */
+
+#ifndef _KEY_MAP_H_
+#define _KEY_MAP_H_
+
+	/* Includes: */
+		#include <stdbool.h>
+		#include <stdint.h>
+
+		#if defined(__AVR__)
+			#include <LUFA/Drivers/USB/USB.h>
+		#else
+			#include "HidUsages.h"
+		#endif
+
+	/* Macros: */
+		/** Id string sent by the Palm Portable Keyboard after its boot handshake. */
+		#define KEYMAP_PALM_PORTABLE_ID0  0xFA
+		#define KEYMAP_PALM_PORTABLE_ID1  0xFD
+
+		/** Set in a byte from the keyboard if the key was released, the other bits are the matrix position. */
+		#define KEYMAP_KEY_RELEASED       0x80
+
+	/* Type Defines: */
+		/** State of the key mapping, i.e. the keyboard report and what is needed to update it. */
+		typedef struct
+		{
+			USB_KeyboardReport_Data_t Report;  //!< report sent to the host
+			uint8_t PressedRaw[6];             //!< raw codes of the keys in Report.KeyCode, in the same order
+			uint8_t UsedKeyCodes;              //!< entries of Report.KeyCode and PressedRaw in use
+			uint8_t LastByte;                  //!< previous byte from the keyboard
+			bool FNPressed;                    //!< FN key held down
+		} KeyMap_t;
+
+		/** translates one byte received from the keyboard into the keyboard report */
+		typedef void (*KeyMap_Handler_t)(KeyMap_t* const KeyMap, const uint8_t data);
+
+	/* Inline Functions: */
+		/** true if the byte from the keyboard releases all keys, the keyboard sends a release twice
+		 *  for that. must be asked before the byte is handed to the key mapping.
+		 */
+		static inline bool KeyMap_IsReleaseAll(const KeyMap_t* const KeyMap, const uint8_t data)
+		{
+			return ((data & KEYMAP_KEY_RELEASED) && (KeyMap->LastByte == data));
+		}
+
+	/* Function Prototypes: */
+		void KeyMap_ReleaseAll(KeyMap_t* const KeyMap);
+		void PalmPortable_ProcessByte(KeyMap_t* const KeyMap, const uint8_t data);
+
+#endif
@@ -47,6 +47,17 @@
 #include <util/delay.h>
 
 		#include "Descriptors.h"
+		#include "Timer.h"
+		#include "KeyMap.h"
+		#include "KeyboardLink.h"
+		#include "SoftwareUart.h"
+		#include "StackMonitor.h"
+		#include "TypingStats.h"
+		#include "LatencyProbe.h"
+		#include "RawEvents.h"
+		#include "UsbTrace.h"
+		#include "VendorInterface.h"
+		#include "WarmStart.h"
 
 		#include <LUFA/Drivers/Board/LEDs.h>
 		#include <LUFA/Drivers/USB/USB.h>
@@ -59,18 +70,33 @@
 		void EVENT_USB_Device_Disconnect(void);
 		void EVENT_USB_Device_ConfigurationChanged(void);
 		void EVENT_USB_Device_ControlRequest(void);
-		void EVENT_USB_Device_StartOfFrame(void);
-
-		bool CALLBACK_HID_Device_CreateHIDReport(USB_ClassInfo_HID_Device_t* const HIDInterfaceInfo,
-		                                         uint8_t* const ReportID,
-		                                         const uint8_t ReportType,
-		                                         void* ReportData,
-		                                         uint16_t* const ReportSize);
-		void CALLBACK_HID_Device_ProcessHIDReport(USB_ClassInfo_HID_Device_t* const HIDInterfaceInfo,
-		                                          const uint8_t ReportID,
-		                                          const uint8_t ReportType,
-		                                          const void* ReportData,
-		                                          const uint16_t ReportSize);
+
+		void SendKeyboardReport(void);
+		void ProcessLEDReport(const uint8_t LEDReport);
+		void Diagnostics_ProcessControlRequest(void);
+
+	/* Type Defines: */
+		/** Firmware health counters, read with a vendor specific control request (see DIAG_REQ_GetReport).
+		 *  All values are little endian.
+		 */
+		typedef struct
+		{
+			uint8_t  Version;               /**< Layout version of this report, currently 3 */
+			uint16_t StaticRAM;             /**< Bytes of RAM taken by .data, .bss and .noinit */
+			uint16_t UnusedRAM;             /**< Smallest number of free bytes ever left below the stack */
+			uint16_t MaxStackDepth;         /**< Largest number of bytes ever used by the stack, including ISRs */
+			uint16_t KeyboardRecoveries;    /**< Number of times a dead keyboard was power cycled */
+			uint16_t KeyboardRecoveryTime;  /**< Duration of the last recovery in milliseconds */
+			uint16_t UartBitTicks;          /**< Measured bit period of the keyboard in Timer1 ticks */
+			uint8_t  UartInverted;          /**< Non-zero if the keyboard uses inverted levels */
+			uint16_t UartMaxLatency;        /**< Worst uart interrupt latency since power up, in Timer1 ticks */
+			uint8_t  ResetFlags;            /**< MCUSR at startup, WDRF set after a watchdog reset (unless a bootloader cleared it) */
+			uint8_t  Resumed;               /**< Non-zero if the keyboard was taken over after a reset without booting it */
+		} ATTR_PACKED Diagnostics_Report_t;
+
+	/* Macros: */
+		/** Vendor specific device request (bmRequestType 0xC0) returning a \ref Diagnostics_Report_t. */
+		#define DIAG_REQ_GetReport           0x01
 
 /** palm portable keyboard interfacing*/
 // pin mapping to keyboard   // a-star micro pins
@@ -80,33 +106,49 @@
 #define VCC_PIN (_BV(PINC6)) // 5
 #define GND_PIN (_BV(PIND7)) // 6
 
-void BootKeyboard(void);
-static volatile unsigned long seconds;
-void ProcessKeyboardSerialByte(void);
-static volatile unsigned char lastByte;
-static volatile unsigned char UsedKeyCodes;
-static volatile USB_KeyboardReport_Data_t KeyboardReport = {0};
-
-static volatile uint8_t pressedRawKeyCode[6] = {255};
-void pressKey(uint8_t raw, uint8_t key);
-void releaseKey(uint8_t raw);
-static volatile uint8_t FN_pressed = 0;
-
-
-// software uart
-typedef enum
+/** serial keyboard protocol driver, selected by the id string the keyboard sends after power up */
+typedef struct
 {
-    IDLE,                                       //!< Idle state, both transmit and receive possible.
-    RECEIVE,                                    //!< Receiving byte.
-    DATA_PENDING                                //!< Byte received and ready to read.
+  uint8_t ID[2];                     //!< first two bytes sent by the keyboard
+  KeyMap_Handler_t ProcessByte;      //!< key mapping for this keyboard
+} KeyboardDriver_t;
 
-}AsynchronousStates_t;
-
-static volatile AsynchronousStates_t state;     //!< Holds the state of the UART.
-static volatile unsigned char SwUartRXData;     //!< Storage for received bits.
-static volatile unsigned char SwUartRXBitCount; //!< RX bit counter.
+/** firmware state that only the main loop touches. nothing in here is volatile, so the compiler is
+ * free to keep values in registers across a key mapping. data shared with interrupts stays in
+ * Timer.c and SoftwareUart.c behind their accessor functions.
+ */
+typedef struct
+{
+  /* key mapping */
+  KeyMap_t KeyMap;                   //!< keyboard report sent to the host, see KeyMap.h
+  KeyMap_Handler_t ProcessByte;      //!< key mapping of the connected keyboard, see SelectKeyboardDriver()
+  uint8_t Driver;                    //!< index of the connected keyboard in KeyboardDrivers
+
+  /* USB reporting */
+  bool ReportDirty;                  //!< Report may have changed since it was last written to the endpoint
+  bool UsingReportProtocol;          //!< report or boot protocol, only kept for Get Protocol requests
+  uint16_t IdleCount;                //!< idle period set by the host in milliseconds
+  uint32_t LastReportTimestamp;      //!< millisecond clock value at which the last report was sent
+
+  /* keyboard link */
+  KeyboardLink_t Link;               //!< boot handshake, supervision and keep awake, see KeyboardLink.h
+  bool Resumed;                      //!< the link was taken over after a reset, see ResumeKeyboard()
+  bool WarmStartDirty;               //!< key state changed since it was last saved, see WarmStartTask()
+
+  /* power */
+  uint32_t LastKeyTimestamp;         //!< arrival of the last byte from the keyboard
+} KeyboardState_t;
 
-static void initSoftwareUart( void );
+void BootKeyboard(void);
+bool ResumeKeyboard(void);
+void WarmStartTask(void);
+void KeyboardLinkTask(void);
+bool KeyboardLinkReady(void);
+uint16_t GetKeyboardRecoveries(void);
+uint16_t GetKeyboardRecoveryTime(void);
+void KeepAwakeTask(void);
+void ClockGovernorTask(void);
+void ProcessKeyboardSerialByte(void);
+void releaseAllKeys(void);
 
 #endif
-
@@ -0,0 +1,200 @@
+/** \file
+ *
+ *  Boot handshake and supervision of the serial keyboard, without blocking the caller's main loop.
+ *  The platform drives the lines through the KeyboardPort_* functions, see KeyboardLink.h:
+ *
+ *  - KeyboardPort_SetPower()   switches the keyboard's supply
+ *  - KeyboardPort_GetDCD()     reads DCD, which the keyboard holds high while it is alive
+ *  - KeyboardPort_GetRTS() and KeyboardPort_SetRTS() read and drive RTS
+ *  - KeyboardPort_ReleaseRTS() stops driving RTS high, so it does not feed the unpowered keyboard
+ *  - KeyboardPort_StartId()    starts recording the id string the keyboard sends after the handshake
+ *  - KeyboardPort_IdProgress() tells how much of it has arrived (any count that grows with it)
+ *  - KeyboardPort_FinishId()   ends the recording once the line has been quiet for a while
+ */
+
+#include "KeyboardLink.h"
+
+/* Timing of the keyboard boot handshake and supervision, in milliseconds. */
+#define BOOT_POWER_OFF_MS    5  //!< Keyboard power is off for this long before booting.
+#define BOOT_POWER_ON_MS    15  //!< Time given to the keyboard to power up before looking at DCD.
+#define BOOT_DCD_TIMEOUT_MS 50  //!< Power cycle again if DCD does not come up within this time.
+#define BOOT_RTS_PULSE_MS   10  //!< Length of the RTS low pulse if RTS was already high.
+#define BOOT_ID_TIMEOUT_MS  50  //!< Power cycle again if the keyboard does not start sending its id.
+#define ID_QUIET_MS         20  //!< Time without edges on the data line after which the id string is complete.
+#define DCD_LOST_MS         20  //!< The keyboard is considered dead if DCD stays low this long.
+
+/* Timing of the RTS keep awake pulse, see KeyboardLink_KeepAwakeTask(). */
+#define KEEPAWAKE_INTERVAL_MS (7UL * 60 * 1000)
+#define KEEPAWAKE_PULSE_MS    10
+
+/** enters a new link state and remembers when that happened */
+static void SetLinkState(KeyboardLink_t* const Link, KeyboardLinkStates_t newState, uint32_t now)
+{
+  Link->State = newState;
+  Link->Timestamp = now;
+}
+
+/** starts the boot handshake by power cycling the keyboard, the rest is done by KeyboardLink_Task().
+ * RTS is released first, a high RTS would otherwise back power the keyboard through its input while
+ * VCC is off. it stays released while the keyboard powers up and is only driven again once DCD is up.
+ */
+void KeyboardLink_Boot(KeyboardLink_t* const Link, const uint32_t Now)
+{
+  KeyboardPort_ReleaseRTS();
+  KeyboardPort_SetPower(false);
+  SetLinkState(Link, LINK_POWER_OFF, Now);
+}
+
+/** takes over a keyboard that is still up, e.g. after the host side restarted, without the boot handshake.
+ * RTS is raised again right away, the keyboard only keeps DCD high if it survived the restart.
+ * \return false if DCD is low, the caller has to boot the keyboard then
+ */
+bool KeyboardLink_Resume(KeyboardLink_t* const Link, const uint32_t Now)
+{
+  KeyboardPort_SetRTS(true);
+  if (!KeyboardPort_GetDCD())
+    return false;
+
+  Link->KeepAwakeTimestamp = Now;
+  Link->KeepAwakePulsing = false;
+  SetLinkState(Link, LINK_READY, Now);
+  return true;
+}
+
+/** runs the boot handshake and afterwards supervises the keyboard
+ *
+ * a keyboard that drops DCD (e.g. after a brown out) is power cycled and booted again, while the
+ * host side stays up. a full boot takes about
+ * BOOT_POWER_OFF_MS + BOOT_POWER_ON_MS + BOOT_RTS_PULSE_MS + ID_QUIET_MS = 50ms plus the
+ * keyboard's own response times, which keeps recovery well below 100ms.
+ */
+KeyboardLinkEvent_t KeyboardLink_Task(KeyboardLink_t* const Link, const uint32_t Now)
+{
+  uint32_t elapsed = Now - Link->Timestamp;
+
+  switch (Link->State)
+    {
+    case LINK_POWER_OFF:
+      if (elapsed >= BOOT_POWER_OFF_MS)
+	{
+	  KeyboardPort_SetPower(true);
+	  SetLinkState(Link, LINK_POWER_ON, Now);
+	}
+      break;
+
+    case LINK_POWER_ON:
+      if (elapsed >= BOOT_POWER_ON_MS)
+	SetLinkState(Link, LINK_WAIT_DCD, Now);
+      break;
+
+    case LINK_WAIT_DCD:
+      // wait until the keyboard has powerd on, it signals this by pulling DCD high..
+      if (KeyboardPort_GetDCD())
+	{
+	  // the keyboard drives its data line from now on, record the id string it sends
+	  // after the handshake
+	  KeyboardPort_StartId();
+	  Link->IdProgress = 0;
+
+	  //.. and then expects the driver to pull RTS high
+	  if (!KeyboardPort_GetRTS()) {
+	    KeyboardPort_SetRTS(true);
+	    SetLinkState(Link, LINK_WAIT_ID, Now);
+	  }
+	  else {
+	    KeyboardPort_SetRTS(false);
+	    SetLinkState(Link, LINK_RTS_PULSE, Now);
+	  }
+	}
+      else if (elapsed >= BOOT_DCD_TIMEOUT_MS)
+	KeyboardLink_Boot(Link, Now);
+      break;
+
+    case LINK_RTS_PULSE:
+      if (elapsed >= BOOT_RTS_PULSE_MS)
+	{
+	  KeyboardPort_SetRTS(true);
+	  SetLinkState(Link, LINK_WAIT_ID, Now);
+	}
+      break;
+
+    case LINK_WAIT_ID:
+      {
+	// wait for the keyboard to send its id string (the first two bytes),
+	// it is complete once the line has been quiet for a while
+	uint8_t recorded = KeyboardPort_IdProgress();
+	if (recorded != Link->IdProgress)
+	  {
+	    Link->IdProgress = recorded;
+	    Link->Timestamp = Now;
+	  }
+	else if (Link->IdProgress && (elapsed >= ID_QUIET_MS))
+	  {
+	    KeyboardPort_FinishId();
+
+	    if (Link->Recovering)
+	      {
+		Link->RecoveryTime = Now - Link->LostTimestamp;
+		Link->Recovering = false;
+	      }
+	    Link->KeepAwakeTimestamp = Now;
+	    Link->KeepAwakePulsing = false;
+	    SetLinkState(Link, LINK_READY, Now);
+	    return LINK_EVENT_READY;
+	  }
+	else if (!Link->IdProgress && (elapsed >= BOOT_ID_TIMEOUT_MS))
+	  KeyboardLink_Boot(Link, Now);
+      }
+      break;
+
+    case LINK_READY:
+      // DCD stays high as long as the keyboard is alive. it is driven from the keyboard's supply, so
+      // the failures a power cycle can fix (brown out, unplugged cable) all drop it. bytes are no
+      // measure, a keyboard nobody types on sends nothing, and the keep awake pulse need not be answered
+      // either. the one state that leaves DCD high, the sleep after 10 minutes, is prevented by
+      // KeyboardLink_KeepAwakeTask() rather than detected
+      if (KeyboardPort_GetDCD())
+	Link->Timestamp = Now;
+      else if (elapsed >= DCD_LOST_MS)
+	{
+	  Link->Recoveries++;
+	  Link->Recovering = true;
+	  Link->LostTimestamp = Link->Timestamp;
+	  KeyboardLink_Boot(Link, Now);
+	  return LINK_EVENT_LOST;
+	}
+      break;
+    }
+
+  return LINK_EVENT_NONE;
+}
+
+/* keyboard goes to non-responsive sleep after 10 minutes of no keypresses and RTS on high
+ * so we toggle RTS every 7 minutes regardless of input just to keep it on its toes :-)
+ * the pulse is timed with the caller's millisecond clock, without blocking
+ */
+void KeyboardLink_KeepAwakeTask(KeyboardLink_t* const Link, const uint32_t Now)
+{
+  if (Link->KeepAwakePulsing)
+    {
+      if (Now - Link->KeepAwakeTimestamp >= KEEPAWAKE_PULSE_MS)
+	{
+	  KeyboardPort_SetRTS(true);
+	  Link->KeepAwakePulsing = false;
+	  Link->KeepAwakeTimestamp = Now;
+	}
+    }
+  else if (Now - Link->KeepAwakeTimestamp >= KEEPAWAKE_INTERVAL_MS)
+    {
+      KeyboardPort_SetRTS(false);
+      Link->KeepAwakePulsing = true;
+      Link->KeepAwakeTimestamp = Now;
+    }
+}
+
+/** a byte from the keyboard shows that it is awake, which restarts the keep awake interval */
+void KeyboardLink_ByteReceived(KeyboardLink_t* const Link, const uint32_t Now)
+{
+  if (!Link->KeepAwakePulsing)
+    Link->KeepAwakeTimestamp = Now; // reset keep awake watchdog
+}
@@ -0,0 +1,76 @@
+/** \file
+ *
+ *  Header file for KeyboardLink.c.
+ *
+ *  The boot handshake and supervision of the serial keyboard, shared by the firmware and the
+ *  Linux driver in ../linux. The lines to the keyboard are driven through the KeyboardPort_*
+ *  functions, which each platform implements.
+ */
+
+#ifndef _KEYBOARD_LINK_H_
+#define _KEYBOARD_LINK_H_
+
+	/* Includes: */
+		#include <stdbool.h>
+		#include <stdint.h>
+
+	/* Type Defines: */
+		/** progress of the keyboard boot handshake, see KeyboardLink_Task() */
+		typedef enum
+		{
+			LINK_POWER_OFF,  //!< keyboard power switched off, RTS released
+			LINK_POWER_ON,   //!< keyboard powering up, RTS still released
+			LINK_WAIT_DCD,   //!< waiting for the keyboard to raise DCD
+			LINK_RTS_PULSE,  //!< RTS pulsed low before raising it
+			LINK_WAIT_ID,    //!< waiting for the id string
+			LINK_READY,      //!< keyboard is up, DCD is supervised
+		} KeyboardLinkStates_t;
+
+		/** what KeyboardLink_Task() has to tell the caller */
+		typedef enum
+		{
+			LINK_EVENT_NONE,   //!< nothing happened
+			LINK_EVENT_READY,  //!< the id string is complete, the keyboard is ready for typing
+			LINK_EVENT_LOST,   //!< the keyboard died and is being booted again, all keys must be released
+		} KeyboardLinkEvent_t;
+
+		/** state of the link to the keyboard, all times are in milliseconds */
+		typedef struct
+		{
+			KeyboardLinkStates_t State;   //!< boot handshake progress
+			uint32_t Timestamp;           //!< entry into the current state, or last time DCD was seen
+			uint8_t IdProgress;           //!< progress of the id string seen so far, see KeyboardPort_IdProgress()
+			bool Recovering;              //!< the current boot is a recovery of a dead keyboard
+			uint32_t LostTimestamp;       //!< last time the dead keyboard was seen alive
+			uint16_t Recoveries;          //!< number of recoveries
+			uint16_t RecoveryTime;        //!< duration of the last recovery
+
+			uint32_t KeepAwakeTimestamp;  //!< start of the current keep awake interval or RTS pulse
+			bool KeepAwakePulsing;        //!< RTS is currently held low
+		} KeyboardLink_t;
+
+	/* Inline Functions: */
+		/** true once the keyboard has sent its id string and is ready for typing */
+		static inline bool KeyboardLink_Ready(const KeyboardLink_t* const Link)
+		{
+			return (Link->State == LINK_READY);
+		}
+
+	/* Function Prototypes: */
+		void KeyboardLink_Boot(KeyboardLink_t* const Link, const uint32_t Now);
+		bool KeyboardLink_Resume(KeyboardLink_t* const Link, const uint32_t Now);
+		KeyboardLinkEvent_t KeyboardLink_Task(KeyboardLink_t* const Link, const uint32_t Now);
+		void KeyboardLink_KeepAwakeTask(KeyboardLink_t* const Link, const uint32_t Now);
+		void KeyboardLink_ByteReceived(KeyboardLink_t* const Link, const uint32_t Now);
+
+		/* Implemented by the platform: */
+		void KeyboardPort_SetPower(const bool On);
+		bool KeyboardPort_GetDCD(void);
+		bool KeyboardPort_GetRTS(void);
+		void KeyboardPort_SetRTS(const bool High);
+		void KeyboardPort_ReleaseRTS(void);
+		void KeyboardPort_StartId(void);
+		uint8_t KeyboardPort_IdProgress(void);
+		void KeyboardPort_FinishId(void);
+
+#endif
@@ -0,0 +1,139 @@
+/** \file
+ *
+ *  Latency probe, enabled with LATENCY_PROBE (see Config/AppConfig.h). Every byte from the
+ *  keyboard is timestamped with Timer1 at each stage on its way to the host: the start bit edge
+ *  and the completed byte in the software UART, the pickup by the main loop, the write of the
+ *  keyboard report into the endpoint bank, and the moment the host has polled that bank. The
+ *  completed records are read as feature reports of the vendor interface by
+ *  tools/latency_probe.py, which adds the delivery to the host's input layer.
+ */
+
+#include "LatencyProbe.h"
+
+#if (LATENCY_PROBE)
+
+#include "Timer.h"
+#include "SoftwareUart.h"
+#include "VendorInterface.h"
+
+/** Bytes that can be on their way to the host at the same time. */
+#define LATENCY_PROBE_IN_FLIGHT   4
+
+/** Completed records kept until the host reads them, must be a power of two. */
+#define LATENCY_PROBE_COMPLETED   16
+
+/** Record of a byte whose report has been written to the endpoint. Internal, kept clear of the
+ *  LATENCY_PROBE_FLAG_* bits in LatencyProbe.h and removed before a record is completed.
+ */
+#define LATENCY_PROBE_FLAG_Written  (1 << 7)
+
+static LatencyProbe_Record_t LatencyProbe_InFlight[LATENCY_PROBE_IN_FLIGHT];
+static uint8_t LatencyProbe_InFlightCount;    //!< Entries of LatencyProbe_InFlight in use.
+
+static LatencyProbe_Record_t LatencyProbe_CompletedRecords[LATENCY_PROBE_COMPLETED];
+static VendorQueue_t LatencyProbe_Completed = VENDOR_QUEUE(LatencyProbe_CompletedRecords);
+
+/** Starts the record of a byte the main loop has just processed.
+ *
+ *  \param[in] Data           Byte received from the keyboard
+ *  \param[in] PickedUp       Timer1 count when the byte was taken out of the receive buffer
+ *  \param[in] ReportChanged  The byte changed the keyboard report
+ */
+void LatencyProbe_ByteProcessed(const uint8_t Data, const uint16_t PickedUp, const bool ReportChanged)
+{
+	if (LatencyProbe_InFlightCount == LATENCY_PROBE_IN_FLIGHT)
+	{
+		VendorQueue_Drop(&LatencyProbe_Completed);
+		return;
+	}
+
+	LatencyProbe_Record_t* Record = &LatencyProbe_InFlight[LatencyProbe_InFlightCount++];
+	uint16_t StartEdge, Decoded;
+
+	Record->Data     = Data;
+	Record->Flags    = (ReportChanged ? 0 : LATENCY_PROBE_FLAG_Unchanged);
+	Record->PickedUp = PickedUp;
+	if (!(SwUart_GetFrameTimes(&StartEdge, &Decoded)))
+	  Record->Flags |= LATENCY_PROBE_FLAG_Stale;
+
+	/* The record is packed, its members are not passed by address */
+	Record->StartEdge = StartEdge;
+	Record->Decoded   = Decoded;
+}
+
+/** Stamps all bytes processed since the last report with the write of the current one. */
+void LatencyProbe_ReportWritten(void)
+{
+	uint16_t Now = Timer_GetTicks();
+
+	for (uint8_t i = 0; i < LatencyProbe_InFlightCount; i++)
+	{
+		if (!(LatencyProbe_InFlight[i].Flags & LATENCY_PROBE_FLAG_Written))
+		{
+			LatencyProbe_InFlight[i].Written = Now;
+			LatencyProbe_InFlight[i].Flags  |= LATENCY_PROBE_FLAG_Written;
+		}
+	}
+}
+
+/** Completes the records of written reports once the host has polled the keyboard endpoint. Also
+ *  called by SendKeyboardReport() right before it writes the next report into the freed bank, which
+ *  would otherwise hide the poll until that report is fetched as well.
+ */
+void LatencyProbe_Task(void)
+{
+	if (!(LatencyProbe_InFlightCount) || !(LatencyProbe_InFlight[0].Flags & LATENCY_PROBE_FLAG_Written))
+	  return;
+
+	if (USB_DeviceState != DEVICE_STATE_Configured)
+	  return;
+
+	/* The bank is free again once the host has taken the report out of it */
+	Endpoint_SelectEndpoint(KEYBOARD_EPADDR);
+	if (!(Endpoint_IsINReady()))
+	  return;
+
+	uint16_t Now          = Timer_GetTicks();
+	uint32_t Milliseconds = Timer_GetMilliseconds();
+	uint8_t  Remaining    = 0;
+
+	for (uint8_t i = 0; i < LatencyProbe_InFlightCount; i++)
+	{
+		LatencyProbe_Record_t* Record = &LatencyProbe_InFlight[i];
+
+		if (!(Record->Flags & LATENCY_PROBE_FLAG_Written))
+		{
+			/* Processed after the report was written, waits for the next one */
+			LatencyProbe_InFlight[Remaining++] = *Record;
+			continue;
+		}
+
+		Record->Fetched      = Now;
+		Record->Milliseconds = Milliseconds;
+
+		LatencyProbe_Record_t* Completed = VendorQueue_Add(&LatencyProbe_Completed);
+		if (Completed != NULL)
+		{
+			*Completed = *Record;
+			Completed->Flags &= ~LATENCY_PROBE_FLAG_Written;
+		}
+	}
+
+	LatencyProbe_InFlightCount = Remaining;
+}
+
+/** Answers Get Report requests for \ref LATENCY_PROBE_REPORTID with the oldest completed records,
+ *  which are then forgotten.
+ *
+ *  \param[in] ReportID  Feature report requested on the vendor interface, see VendorInterface_FeatureReportID()
+ */
+void LatencyProbe_ProcessFeatureReport(const uint8_t ReportID)
+{
+	if ((ReportID != LATENCY_PROBE_REPORTID) || (USB_ControlRequest.bRequest != HID_REQ_GetReport))
+	  return;
+
+	LatencyProbe_Report_t Report;
+	VendorQueue_SendReport(&LatencyProbe_Completed, LATENCY_PROBE_REPORTID, &Report, sizeof(Report));
+}
+
+#endif
@@ -0,0 +1,66 @@
+/** \file
+ *
+ *  Header file for LatencyProbe.c.
+ */
+
+#ifndef _LATENCY_PROBE_H_
+#define _LATENCY_PROBE_H_
+
+	/* Includes: */
+		#include <stdbool.h>
+		#include <stdint.h>
+
+		#include "Config/AppConfig.h"
+		#include "Descriptors.h"
+
+	/* Macros: */
+		/** Report ID of \ref LatencyProbe_Report_t on the vendor interface. */
+		#define LATENCY_PROBE_REPORTID            0x04
+
+		/** Number of records per report, more are kept on the device until the next report. */
+		#define LATENCY_PROBE_RECORDS_PER_REPORT  6
+
+	/* Type Defines: */
+		/** Path of one keyboard byte through the firmware. All timestamps are Timer1 counts
+		 *  (TIMER_TICKS_PER_SECOND, wrapping at 65536), so only their differences are meaningful.
+		 */
+		typedef struct
+		{
+			uint8_t  Data;          /**< Byte received from the keyboard */
+			uint8_t  Flags;         /**< LATENCY_PROBE_FLAG_* */
+			uint32_t Milliseconds;  /**< Millisecond clock when the host fetched the report, to relate records to host time */
+			uint16_t StartEdge;     /**< Start bit edge on the RX line */
+			uint16_t Decoded;       /**< Byte complete, put into the receive buffer by the interrupt */
+			uint16_t PickedUp;      /**< Byte taken out of the buffer by ProcessKeyboardSerialByte() */
+			uint16_t Written;       /**< Keyboard report containing the byte's effect written to the endpoint */
+			uint16_t Fetched;       /**< Endpoint bank free again, i.e. the host has polled the report */
+		} ATTR_PACKED LatencyProbe_Record_t;
+
+		/** Feature report with the records completed since the previous one, starts like a \ref VendorReport_Header_t. */
+		typedef struct
+		{
+			uint8_t  ReportID;   /**< \ref LATENCY_PROBE_REPORTID */
+			uint8_t  Count;      /**< Valid entries of Records */
+			uint8_t  Lost;       /**< Records dropped since the previous report because nobody read them, saturating */
+			LatencyProbe_Record_t Records[LATENCY_PROBE_RECORDS_PER_REPORT];
+		} ATTR_PACKED LatencyProbe_Report_t;
+
+		/** The report written for the byte did not change (e.g. a repeated key release), so no host event follows. */
+		#define LATENCY_PROBE_FLAG_Unchanged      (1 << 0)
+
+		/** The byte waited in the receive buffer so long that StartEdge and Decoded may have wrapped. */
+		#define LATENCY_PROBE_FLAG_Stale          (1 << 1)
+
+	/* Function Prototypes: */
+		#if (LATENCY_PROBE)
+			void LatencyProbe_ByteProcessed(const uint8_t Data, const uint16_t PickedUp, const bool ReportChanged);
+			void LatencyProbe_ReportWritten(void);
+			void LatencyProbe_Task(void);
+			void LatencyProbe_ProcessFeatureReport(const uint8_t ReportID);
+		#else
+			static inline void LatencyProbe_ByteProcessed(const uint8_t Data, const uint16_t PickedUp, const bool ReportChanged) {}
+			static inline void LatencyProbe_ReportWritten(void) {}
+			static inline void LatencyProbe_Task(void) {}
+		#endif
+
+#endif
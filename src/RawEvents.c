@@ -0,0 +1,137 @@
+/** \file
+ *
+ *  Raw key events, enabled with RAW_EVENTS (see Config/AppConfig.h). For hosts that do their own
+ *  key mapping, every byte from the keyboard is passed on as it is, with the time of its start bit,
+ *  in input reports of the vendor interface. The host switches this on with a Set Report of
+ *  \ref RAW_EVENTS_REPORTID_Mode, either next to the keyboard reports or instead of them. The
+ *  vendor endpoint is polled every millisecond, all events that arrived in between share a report.
+ *
+ *  In the exclusive mode the keyboard interface takes over again when a report has not been
+ *  fetched for RAW_EVENTS_TIMEOUT_MS, e.g. because the host software has quit. The events of that
+ *  report are lost to the keyboard interface.
+ */
+
+#include "RawEvents.h"
+
+#if (RAW_EVENTS)
+
+#include "Keyboard.h"
+
+/** Events kept until the host fetches them, must be a power of two. */
+#define RAW_EVENTS_QUEUE_SIZE  16
+
+/** Time an exclusive host has to fetch a report before the keyboard interface takes over. */
+#define RAW_EVENTS_TIMEOUT_MS  200
+
+static uint8_t RawEvents_Mode;                //!< RAW_EVENTS_MODE_*
+static RawEvents_Event_t RawEvents_Events[RAW_EVENTS_QUEUE_SIZE];
+static VendorQueue_t RawEvents_Queue = VENDOR_QUEUE(RawEvents_Events);
+static uint32_t RawEvents_EndpointFree;       //!< Last time the vendor endpoint bank was seen free.
+
+/** Switches raw events off and forgets what was queued, e.g. after the host has re-enumerated the device. */
+void RawEvents_Reset(void)
+{
+	RawEvents_Mode = RAW_EVENTS_MODE_Off;
+	VendorQueue_Clear(&RawEvents_Queue);
+}
+
+/** true if the key mapping is switched off, the events go to the host only. */
+bool RawEvents_Exclusive(void)
+{
+	return (RawEvents_Mode == RAW_EVENTS_MODE_Exclusive);
+}
+
+/** Queues the byte last taken from the software UART, if raw events are switched on.
+ *
+ *  \param[in] Data  Byte received from the keyboard
+ */
+void RawEvents_ByteReceived(const uint8_t Data)
+{
+	if (RawEvents_Mode == RAW_EVENTS_MODE_Off)
+	  return;
+
+	RawEvents_Event_t* Event = VendorQueue_Add(&RawEvents_Queue);
+	if (Event == NULL)
+	  return;
+
+	uint16_t StartEdge, Decoded;
+	bool Recent = SwUart_GetFrameTimes(&StartEdge, &Decoded);
+
+	Event->Data         = Data;
+	Event->Microseconds = Recent ? Timer_TicksToMicroseconds(StartEdge) : RAW_EVENTS_TIME_Unknown;
+}
+
+/** Writes the queued events to the vendor endpoint once its bank is free, and gives the keys back to
+ *  the keyboard interface if an exclusive host stops reading.
+ */
+void RawEvents_Task(void)
+{
+	if ((RawEvents_Mode == RAW_EVENTS_MODE_Off) || (USB_DeviceState != DEVICE_STATE_Configured))
+	  return;
+
+	uint32_t Now = Timer_GetMilliseconds();
+
+	Endpoint_SelectEndpoint(VENDOR_EPADDR);
+	if (!(Endpoint_IsINReady()))
+	{
+		if (RawEvents_Exclusive() && ((Now - RawEvents_EndpointFree) >= RAW_EVENTS_TIMEOUT_MS))
+		  RawEvents_Reset();
+
+		return;
+	}
+
+	RawEvents_EndpointFree = Now;
+
+	if (VendorQueue_IsEmpty(&RawEvents_Queue))
+	  return;
+
+	RawEvents_Report_t Report;
+	VendorQueue_FillReport(&RawEvents_Queue, RAW_EVENTS_REPORTID_Events, &Report, sizeof(Report));
+
+	Endpoint_Write_Stream_LE(&Report, sizeof(Report), NULL);
+	Endpoint_ClearIN();
+	UsbTrace_ReportWritten(VENDOR_EPADDR, &Report, sizeof(Report));
+}
+
+/** Answers Get Report and Set Report requests for \ref RAW_EVENTS_REPORTID_Mode.
+ *
+ *  \param[in] ReportID  Feature report requested on the vendor interface, see VendorInterface_FeatureReportID()
+ */
+void RawEvents_ProcessFeatureReport(const uint8_t ReportID)
+{
+	if (ReportID != RAW_EVENTS_REPORTID_Mode)
+	  return;
+
+	uint8_t Report[2] = {RAW_EVENTS_REPORTID_Mode, RawEvents_Mode};
+
+	switch (USB_ControlRequest.bRequest)
+	{
+		case HID_REQ_GetReport:
+			Endpoint_ClearSETUP();
+			Endpoint_Write_Control_Stream_LE(Report, sizeof(Report));
+			Endpoint_ClearOUT();
+
+			break;
+		case HID_REQ_SetReport:
+			if (USB_ControlRequest.wLength != sizeof(Report))
+			  break;
+
+			Endpoint_ClearSETUP();
+			Endpoint_Read_Control_Stream_LE(Report, sizeof(Report));
+			Endpoint_ClearIN();
+
+			if (Report[1] > RAW_EVENTS_MODE_Exclusive)
+			  break;
+
+			/* Keys held now would stay pressed on the keyboard interface, the key mapping misses their release */
+			if ((Report[1] == RAW_EVENTS_MODE_Exclusive) && !RawEvents_Exclusive())
+			  releaseAllKeys();
+
+			RawEvents_Mode         = Report[1];
+			RawEvents_EndpointFree = Timer_GetMilliseconds();
+
+			break;
+	}
+}
+
+#endif
@@ -0,0 +1,75 @@
+/** \file
+ *
+ *  Header file for RawEvents.c.
+ */
+
+#ifndef _RAW_EVENTS_H_
+#define _RAW_EVENTS_H_
+
+	/* Includes: */
+		#include <stdbool.h>
+		#include <stdint.h>
+
+		#include "Config/AppConfig.h"
+		#include "Descriptors.h"
+
+	/* Macros: */
+		/** Report ID of \ref RawEvents_Report_t, an input report of the vendor interface. */
+		#define RAW_EVENTS_REPORTID_Events  0x05
+
+		/** Report ID of the one byte feature report holding the RAW_EVENTS_MODE_* of the device. */
+		#define RAW_EVENTS_REPORTID_Mode    0x06
+
+		/** Events per input report, as many as fit into the vendor endpoint. */
+		#define RAW_EVENTS_PER_REPORT       12
+
+		/** The keyboard interface works as usual, no raw events are sent (default after enumeration). */
+		#define RAW_EVENTS_MODE_Off         0
+
+		/** Raw events are sent in addition to the keyboard reports. */
+		#define RAW_EVENTS_MODE_Shared      1
+
+		/** Raw events are sent instead of the keyboard reports, the key mapping is skipped. Falls back to
+		 *  \ref RAW_EVENTS_MODE_Off if the host stops reading the events.
+		 */
+		#define RAW_EVENTS_MODE_Exclusive   2
+
+		/** Time of an event that waited in the firmware too long for its start bit to be dated, e.g. while
+		 *  the main loop was stalled. The event itself is valid.
+		 */
+		#define RAW_EVENTS_TIME_Unknown     UINT32_MAX
+
+	/* Type Defines: */
+		/** One byte from the keyboard: bit 7 set for a key release, the lower bits are the matrix position. */
+		typedef struct
+		{
+			uint8_t  Data;          /**< Byte as received from the keyboard */
+			uint32_t Microseconds;  /**< Start bit edge, on the device's microsecond time line (wraps after about 71 minutes), or \ref RAW_EVENTS_TIME_Unknown */
+		} ATTR_PACKED RawEvents_Event_t;
+
+		/** Input report with the events received since the previous one, oldest first. Starts like a
+		 *  \ref VendorReport_Header_t.
+		 */
+		typedef struct
+		{
+			uint8_t ReportID;   /**< \ref RAW_EVENTS_REPORTID_Events */
+			uint8_t Count;      /**< Valid entries of Events */
+			uint8_t Lost;       /**< Events dropped since the previous report because the host did not read them, saturating */
+			RawEvents_Event_t Events[RAW_EVENTS_PER_REPORT];
+		} ATTR_PACKED RawEvents_Report_t;
+
+	/* Function Prototypes: */
+		#if (RAW_EVENTS)
+			void RawEvents_Reset(void);
+			void RawEvents_ByteReceived(const uint8_t Data);
+			bool RawEvents_Exclusive(void);
+			void RawEvents_Task(void);
+			void RawEvents_ProcessFeatureReport(const uint8_t ReportID);
+		#else
+			static inline void RawEvents_Reset(void) {}
+			static inline void RawEvents_ByteReceived(const uint8_t Data) {}
+			static inline bool RawEvents_Exclusive(void) { return false; }
+			static inline void RawEvents_Task(void) {}
+		#endif
+
+#endif
@@ -0,0 +1,485 @@
+/** \file
+ *
+ *  Receive only software UART for the keyboard's serial line.
+ *
+ *  Originally after
+ *  http://www.atmel.com/Images/doc0941.pdf "AVR304: Half Duplex Interrupt Driven Software UART"
+ *  http://www.element14.com/community/docs/DOC-56281/l/avr304-half-duplex-interrupt-driven-software-uart-on-tinyavr-and-megaavr-devices-coding
+ *
+ *  Instead of sampling every bit in a timer interrupt, only the edges on the RX line are
+ *  timestamped with the free running Timer1. Each edge tells that the line kept its previous
+ *  level up to that point, so all data bits whose centre lies before the edge are shifted in
+ *  at once. Trailing bits without a following edge are filled in by a single compare interrupt
+ *  in the middle of the stop bit. A byte therefore costs one interrupt per level change plus at
+ *  most one timeout, e.g. two interrupts for 0x00 and three for 0xFF instead of ten.
+ *
+ *  Bit timing and line polarity are runtime settings. They default to BAUDRATE and
+ *  INVERT_LEVELS, and can be measured from the first bytes the keyboard sends, see
+ *  \ref SwUart_StartCalibration().
+ */
+
+#include "SoftwareUart.h"
+
+#define RX_PIN 0               //!< Receive data pin, must be INT0
+#define INVERT_LEVELS 1 // 0: use standard active low signal levels - 1: use active high
+
+#define TRXDDR  DDRD
+#define TRXPORT PORTD
+#define TRXPIN  PIND
+
+#define GET_RX_PIN( )    ( TRXPIN & ( 1 << RX_PIN ) )
+#define GET_RX_LEVEL( )  ( GET_RX_PIN( ) == SwUartIdlePin ) //!< Logical level of the line, 1 is mark/idle.
+
+// chip specific configuration
+// frame timeout uses output compare channel B of the free running Timer1, see Timer.c
+#define ENABLE_TIMER_INTERRUPT( )       ( TIMSK1 |= ( 1<< OCIE1B ) )
+#define DISABLE_TIMER_INTERRUPT( )      ( TIMSK1 &= ~( 1<< OCIE1B ) )
+#define CLEAR_TIMER_INTERRUPT( )        ( TIFR1 = ( 1 << OCF1B ) ) // write only this flag, OCF1A belongs to the millisecond clock
+#define ENABLE_EXTERNAL0_INTERRUPT( )   ( EIMSK |= ( 1<< INT0 ) )
+#define DISABLE_EXTERNAL0_INTERRUPT( )  ( EIMSK &= ~( 1<< INT0 ) )
+#define OCR              OCR1B              //!< Output Compare Register
+#define EXT_IFR          EIFR              //!< External Interrupt Flag Register
+#define EXT_ICR          EICRA             //!< External Interrupt Control Register
+#define TIMER_COMP_VECT  TIMER1_COMPB_vect  //!< Timer Compare Interrupt Vector
+
+#if !defined(INTERRUPT_EXEC_CYCL)
+#define INTERRUPT_EXEC_CYCL   32      //!< CPU cycles elapsed from the edge until TCNT1 is read in the interrupt rutine, set by the makefile. `make wcet-check` measures it.
+#endif
+#define INTERRUPT_EXEC_TICKS( clockdiv )  ( ( INTERRUPT_EXEC_CYCL * (clockdiv) + TIMER_PRESCALER / 2 ) / TIMER_PRESCALER ) //!< The same in Timer1 ticks, at F_CPU / clockdiv
+
+#define SWUART_RX_BUFFER_SIZE    8    //!< Received bytes not yet fetched by the main loop, must be a power of two.
+#define SWUART_CALIBRATION_EDGES 24   //!< Edges recorded for a calibration, two bytes have at most 20.
+
+#define SWUART_FRAME_TIMES_MAX_AGE_MS  ( 32768 / TIMER_TICKS_PER_MS - 1 ) //!< Time a byte may wait in the buffer before its timestamps could have wrapped.
+
+#define SWUART_MAX_BAUD_ERROR_PERMILLE  20  //!< Bit period rounding error allowed at BAUDRATE, 9.5 bits may drift a fifth of a bit.
+
+// Timer1 runs at F_CPU / TIMER_PRESCALER, at 16MHz one bit at 9600 baud lasts 208.3 ticks
+#define BAUD_TICKS(baud)  ( ( TIMER_TICKS_PER_SECOND + (baud) / 2 ) / (baud) )
+
+#if ( ( BAUD_TICKS(BAUDRATE) * BAUDRATE * 1000 ) > ( TIMER_TICKS_PER_SECOND * ( 1000 + SWUART_MAX_BAUD_ERROR_PERMILLE ) ) ) || \
+    ( ( BAUD_TICKS(BAUDRATE) * BAUDRATE * 1000 ) < ( TIMER_TICKS_PER_SECOND * ( 1000 - SWUART_MAX_BAUD_ERROR_PERMILLE ) ) )
+  #error BAUDRATE cannot be timed accurately enough at F_CPU / TIMER_PRESCALER, see SWUART_MAX_BAUD_ERROR_PERMILLE.
+#endif
+
+/** Bit periods of the common baudrates, a measured bit period close to one of these is snapped to it. */
+static const uint16_t SwUartStandardBitTicks[] PROGMEM =
+  {
+    BAUD_TICKS(1200), BAUD_TICKS(2400), BAUD_TICKS(4800),
+    BAUD_TICKS(9600), BAUD_TICKS(19200), BAUD_TICKS(38400),
+  };
+
+static uint16_t SwUartBitTicks;                 //!< Wait one bit period.
+static uint16_t SwUartFirstSampleTicks;         //!< Wait one and a half bit period.
+static uint16_t SwUartStopBitTicks;             //!< From the start edge to the middle of the stop bit.
+static uint8_t SwUartIdlePin;                   //!< Value of GET_RX_PIN( ) while the line is idle.
+
+static volatile uint8_t SwUartRXBuffer[SWUART_RX_BUFFER_SIZE]; //!< Received bytes.
+static volatile uint8_t SwUartRXHead;           //!< Next free slot, only written by the receiver.
+static volatile uint8_t SwUartRXTail;           //!< Next byte to fetch, only written by SwUart_ReceiveByte( ).
+
+#if (SWUART_FRAME_TIMES)
+static volatile uint16_t SwUartRXStartTime[SWUART_RX_BUFFER_SIZE]; //!< Timestamp of the start edge of each buffered byte.
+static volatile uint16_t SwUartRXDoneTime[SWUART_RX_BUFFER_SIZE];  //!< Timestamp at which each buffered byte was complete.
+static uint16_t SwUartRXStart;                  //!< Start edge of the frame being received.
+static uint16_t SwUartLastStartTime;            //!< Start edge of the byte last returned by SwUart_ReceiveByte( ).
+static uint16_t SwUartLastDoneTime;             //!< Completion of the byte last returned by SwUart_ReceiveByte( ).
+static bool SwUartLastStale;                    //!< The byte last returned waited longer than SWUART_FRAME_TIMES_MAX_AGE_MS.
+static uint32_t SwUartEmptyTime;                //!< Last time SwUart_ReceiveByte( ) found the buffer empty, in milliseconds.
+#endif
+
+// only used from within the interrupt routines (or with interrupts disabled)
+static bool SwUartReceiving;                    //!< A frame is being received.
+static unsigned char SwUartRXShift;             //!< Storage for received bits.
+static unsigned char SwUartRXBitCount;          //!< RX bit counter.
+static unsigned char SwUartRXLevel;             //!< Logical line level since the last edge.
+static uint16_t SwUartRXNextSample;             //!< Timestamp of the middle of the next data bit.
+static uint16_t SwUartRXTimeout;                //!< Timestamp of the middle of the stop bit.
+
+static volatile uint16_t SwUartMaxLatency;      //!< Largest delay of the frame timeout interrupt, in Timer1 ticks.
+
+static volatile bool SwUartCalibrating;         //!< Edges are only recorded, not decoded.
+static volatile uint8_t SwUartCalibrationEdgeCount;
+static uint16_t SwUartCalibrationEdges[SWUART_CALIBRATION_EDGES]; //!< Timestamps of the recorded edges.
+static uint32_t SwUartCalibrationPins;          //!< Bit n set if the pin was high after edge n.
+static uint32_t SwUartCalibrationMask;          //!< Bit of SwUartCalibrationPins for the next edge, shifted on by the interrupt.
+
+/** Sets the bit period, in Timer1 ticks, all other frame timings are derived from. */
+static void SwUart_SetBitTicks( uint16_t BitTicks )
+{
+  SwUartBitTicks = BitTicks;
+  SwUartFirstSampleTicks = BitTicks + BitTicks/2;
+  SwUartStopBitTicks = 9*BitTicks + BitTicks/2;
+}
+
+void SwUart_Init( void )
+{
+  //PORT
+  TRXPORT |= ( 1 << RX_PIN );       // RX_PIN is input, tri-stated.
+
+  // Timer1 is already running, see Timer_Init()
+  DISABLE_TIMER_INTERRUPT( );
+
+  SwUart_SetBitTicks( BAUD_TICKS(BAUDRATE) );
+#if INVERT_LEVELS
+  SwUartIdlePin = 0;
+#else
+  SwUartIdlePin = ( 1 << RX_PIN );
+#endif
+
+  //External interrupt
+  EXT_ICR = 0x00;                   // Init.
+  EXT_ICR |= ( 1 << ISC00 );        // Interrupt sense control: any logical change.
+  EXT_IFR = ( 1 << INTF0 );         // Forget edges from before the initialisation.
+  ENABLE_EXTERNAL0_INTERRUPT( );    // Turn external interrupt on.
+
+  //Internal State Variable
+  SwUartReceiving = false;
+  SwUartCalibrating = false;
+  SwUartRXHead = SwUartRXTail = 0;
+}
+
+/*! \brief  Fetches the oldest received byte.
+ *
+ *  The receiver only ever moves the head and this function only the tail of
+ *  the buffer, so no locking is needed.
+ *
+ *  \return The received byte, or -1 if no byte is waiting.
+ */
+int16_t SwUart_ReceiveByte( void )
+{
+  uint8_t Tail = SwUartRXTail;
+
+  if( Tail == SwUartRXHead ) {
+#if (SWUART_FRAME_TIMES)
+    SwUartEmptyTime = Timer_GetMilliseconds( );
+#endif
+    return -1;
+  }
+
+  uint8_t Data = SwUartRXBuffer[Tail];
+#if (SWUART_FRAME_TIMES)
+  SwUartLastStartTime = SwUartRXStartTime[Tail];
+  SwUartLastDoneTime = SwUartRXDoneTime[Tail];
+  // the byte arrived after the buffer was last seen empty, that bounds its age
+  SwUartLastStale = ( Timer_GetMilliseconds( ) - SwUartEmptyTime ) > SWUART_FRAME_TIMES_MAX_AGE_MS;
+#endif
+  SwUartRXTail = ( Tail + 1 ) & ( SWUART_RX_BUFFER_SIZE - 1 );
+
+  return Data;
+}
+
+#if (SWUART_FRAME_TIMES)
+/*! \brief  Reception timestamps of the byte last returned by SwUart_ReceiveByte( ).
+ *
+ *  The timestamps are only good for comparisons with the current Timer1 count while they are
+ *  less than 32768 ticks old. A main loop that stalled may pick up bytes older than that.
+ *
+ *  \param[out] StartEdge  Timer1 count at the start bit's edge.
+ *  \param[out] Done       Timer1 count when the byte was put into the receive buffer.
+ *
+ *  \return false if the byte may have waited 32768 ticks or longer in the buffer.
+ */
+bool SwUart_GetFrameTimes( uint16_t* const StartEdge, uint16_t* const Done )
+{
+  *StartEdge = SwUartLastStartTime;
+  *Done = SwUartLastDoneTime;
+  return !SwUartLastStale;
+}
+#endif
+
+/** \return Current bit period in Timer1 ticks. */
+uint16_t SwUart_GetBitTicks( void )
+{
+  return SwUartBitTicks;
+}
+
+/*! \brief  Worst case interrupt latency seen by the receiver.
+ *
+ *  Measured in the frame timeout interrupt as the time from the compare
+ *  match to the start of the interrupt routine. Every key release byte
+ *  of the Palm keyboard ends with a one bit and so runs the timeout,
+ *  making this the jitter of the receiver's timestamps.
+ *
+ *  \return Largest latency in Timer1 ticks since power up.
+ */
+uint16_t SwUart_GetMaxLatency( void )
+{
+  uint16_t Latency;
+
+  ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+  {
+    Latency = SwUartMaxLatency;
+  }
+
+  return Latency;
+}
+
+/** \return true if the line idles low, i.e. uses inverted (active high) levels. */
+bool SwUart_IsInverted( void )
+{
+  return ( SwUartIdlePin == 0 );
+}
+
+/*! \brief  Shifts in all data bits that ended before the given timestamp.
+ *
+ *  All bits whose centre lies before \p Timestamp had the level
+ *  that was on the line since the previous edge. Once the eighth
+ *  data bit is in, the byte is handed over to the main loop.
+ */
+static inline void SwUart_ShiftBits( uint16_t Timestamp )
+{
+  while( (int16_t)(Timestamp - SwUartRXNextSample) >= 0 ) {
+    SwUartRXShift >>= 1;                // Shift due to receiving LSB first.
+    if( SwUartRXLevel ) {
+      SwUartRXShift |= 0x80;            // If a logical 1 is read, let the data mirror this.
+    }
+    SwUartRXNextSample += SwUartBitTicks;
+
+    //Done receiving
+    if( ++SwUartRXBitCount == 8 ) {
+      uint8_t Head = SwUartRXHead;
+      uint8_t Next = ( Head + 1 ) & ( SWUART_RX_BUFFER_SIZE - 1 );
+
+      if( Next != SwUartRXTail ) {      // Drop the byte if the main loop fell behind.
+        SwUartRXBuffer[Head] = SwUartRXShift;
+#if (SWUART_FRAME_TIMES)
+        SwUartRXStartTime[Head] = SwUartRXStart;
+        SwUartRXDoneTime[Head] = TCNT1;
+#endif
+        SwUartRXHead = Next;
+      }
+
+      SwUartReceiving = false;
+      DISABLE_TIMER_INTERRUPT( );
+      return;
+    }
+  }
+}
+
+/*! \brief  Handles one edge of the RX line.
+ *
+ *  While idle, an edge to the space level is the start of a new
+ *  frame: the timeout is set to the middle of the stop bit. Every
+ *  further edge completes the bits before it.
+ *
+ *  \param[in] Timestamp  Timer1 count at the edge.
+ *  \param[in] Level      Logical line level after the edge.
+ */
+static inline void SwUart_Edge( uint16_t Timestamp, uint8_t Level )
+{
+  if( SwUartReceiving ) {
+    if( ( SwUartRXBitCount == 0 ) && ( (int16_t)(Timestamp - SwUartRXNextSample + SwUartBitTicks) < 0 ) ) {
+      SwUartReceiving = false;          // Start bit shorter than half a bit, just a glitch.
+      DISABLE_TIMER_INTERRUPT( );
+      return;
+    }
+
+    SwUart_ShiftBits( Timestamp );
+    if( SwUartReceiving ) {
+      SwUartRXLevel ^= 1;
+      return;
+    }
+    // The frame ended with this edge, which might already be the next start bit.
+  }
+
+  if( Level == 0 ) {
+    SwUartReceiving = true;             // Start bit.
+    SwUartRXLevel = 0;
+    SwUartRXBitCount = 0;
+    SwUartRXNextSample = Timestamp + SwUartFirstSampleTicks;
+    SwUartRXTimeout = Timestamp + SwUartStopBitTicks;
+#if (SWUART_FRAME_TIMES)
+    SwUartRXStart = Timestamp;
+#endif
+
+    OCR = SwUartRXTimeout;
+    CLEAR_TIMER_INTERRUPT( );
+    ENABLE_TIMER_INTERRUPT( );
+  }
+}
+
+/*! \brief  Completes a frame that has reached the middle of its stop bit.
+ *
+ *  Happens whenever the last data bits are ones, so no edge
+ *  follows them. The remaining bits are filled with the current
+ *  line level. A frame whose stop bit reads as space is dropped
+ *  as a framing error.
+ */
+static inline void SwUart_Timeout( void )
+{
+  DISABLE_TIMER_INTERRUPT( );
+
+  if( !SwUartReceiving )
+    return;
+
+  if( SwUartRXLevel == 0 ) {
+    SwUartReceiving = false;            // Framing error, no stop bit.
+    return;
+  }
+
+  SwUart_ShiftBits( SwUartRXTimeout );
+}
+
+/*! \brief  Starts recording edges instead of decoding them.
+ *
+ *  Used while the keyboard sends its id bytes after power up, before
+ *  its baudrate and polarity are known. The line must be idle and
+ *  driven by the keyboard, so the first edge is a start bit. Bytes
+ *  not fetched yet are discarded.
+ */
+void SwUart_StartCalibration( void )
+{
+  ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+  {
+    SwUartReceiving = false;
+    DISABLE_TIMER_INTERRUPT( );
+    SwUartRXTail = SwUartRXHead;        // Whatever was decoded so far is noise from powering up.
+    SwUartCalibrationEdgeCount = 0;
+    SwUartCalibrationPins = 0;
+    SwUartCalibrationMask = 1;
+    SwUartCalibrating = true;
+  }
+}
+
+/** \return Number of edges recorded since \ref SwUart_StartCalibration(). */
+uint8_t SwUart_GetCalibrationEdges( void )
+{
+  return SwUartCalibrationEdgeCount;
+}
+
+/*! \brief  Derives bit timing and polarity from the recorded edges.
+ *
+ *  The first edge leads from idle into the start bit, which gives
+ *  the polarity. The shortest time between two edges is one bit,
+ *  snapped to the nearest standard baudrate if within 12%. The
+ *  recorded edges are then decoded with the new settings, so the
+ *  measured bytes are not lost, and decoding resumes normally.
+ *
+ *  \return false if too few edges were recorded, the previous settings are kept then.
+ */
+bool SwUart_FinishCalibration( void )
+{
+  bool Success = false;
+
+  ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+  {
+    uint8_t Edges = SwUartCalibrationEdgeCount;
+    SwUartCalibrating = false;
+
+    if( Edges >= 2 ) {
+      SwUartIdlePin = ( SwUartCalibrationPins & 1 ) ? 0 : ( 1 << RX_PIN );
+
+      uint16_t Shortest = UINT16_MAX;
+      for( uint8_t i = 1; i < Edges; i++ ) {
+        uint16_t Interval = SwUartCalibrationEdges[i] - SwUartCalibrationEdges[i-1];
+        if( Interval < Shortest )
+          Shortest = Interval;
+      }
+
+      for( uint8_t i = 0; i < sizeof(SwUartStandardBitTicks) / sizeof(SwUartStandardBitTicks[0]); i++ ) {
+        uint16_t Standard = pgm_read_word( &SwUartStandardBitTicks[i] );
+        if( ( Shortest > Standard - Standard/8 ) && ( Shortest < Standard + Standard/8 ) ) {
+          Shortest = Standard;
+          break;
+        }
+      }
+
+      SwUart_SetBitTicks( Shortest );
+
+      // replay the recorded edges through the decoder
+      for( uint8_t i = 0; i < Edges; i++ ) {
+        uint16_t Timestamp = SwUartCalibrationEdges[i];
+        bool PinHigh = ( SwUartCalibrationPins & ( 1UL << i ) );
+
+        if( SwUartReceiving && ( (int16_t)(Timestamp - SwUartRXTimeout) >= 0 ) )
+          SwUart_Timeout( );
+
+        SwUart_Edge( Timestamp, PinHigh == ( SwUartIdlePin != 0 ) );
+      }
+      SwUart_Timeout( );
+
+      Success = true;
+    }
+
+    SwUartReceiving = false;
+    DISABLE_TIMER_INTERRUPT( );
+    CLEAR_TIMER_INTERRUPT( );
+  }
+
+  return Success;
+}
+
+
+/*! \brief  Applies the results of an earlier calibration.
+ *
+ *  For a keyboard that was measured before the firmware restarted, see
+ *  \ref SwUart_GetBitTicks() and \ref SwUart_IsInverted().
+ */
+void SwUart_RestoreCalibration( const uint16_t BitTicks, const bool Inverted )
+{
+  ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+  {
+    SwUart_SetBitTicks( BitTicks );
+    SwUartIdlePin = Inverted ? 0 : ( 1 << RX_PIN );
+    SwUartReceiving = false;
+    DISABLE_TIMER_INTERRUPT( );
+  }
+}
+
+/*! \brief  External interrupt service routine.
+ *
+ *  Triggers on both edges of the RX line. An edge that comes while
+ *  interrupts are disabled is timestamped late, up to half a bit is
+ *  tolerated. A second edge within that time would be lost, which is
+ *  why all other interrupt routines enable interrupts right away.
+ *
+ *  \note  SwUart_Init( void ) must be called in advance.
+ */
+ISR( INT0_vect )
+{
+  uint16_t Timestamp = TCNT1;
+
+  // the first edge after idle brings the CPU back to full speed, getting
+  // here took the same cycles at the lower clock, i.e. more timer ticks
+  if( Timer_IsSlowClock( ) ) {
+    Timer_EnterFullClock( );
+    Timestamp -= INTERRUPT_EXEC_TICKS( TIMER_IDLE_CLOCK_DIV );
+  }
+  else {
+    Timestamp -= INTERRUPT_EXEC_TICKS( 1 );
+  }
+
+  if( SwUartCalibrating ) {
+    uint8_t Count = SwUartCalibrationEdgeCount;
+    if( Count < SWUART_CALIBRATION_EDGES ) {
+      SwUartCalibrationEdges[Count] = Timestamp;
+      // a variable shift would be a loop of up to 24 rounds, the mask moves on by one bit per edge
+      if( GET_RX_PIN( ) )
+        SwUartCalibrationPins |= SwUartCalibrationMask;
+      SwUartCalibrationMask <<= 1;
+      SwUartCalibrationEdgeCount = Count + 1;
+    }
+    return;
+  }
+
+  SwUart_Edge( Timestamp, GET_RX_LEVEL( ) );
+}
+
+
+/*! \brief  Timer1 compare B interrupt service routine.
+ *
+ *  Fires in the middle of the stop bit if the frame has
+ *  not been completed by an edge.
+ *
+ *  \note  SwUart_Init( void ) must be called in advance.
+ */
+ISR( TIMER_COMP_VECT )
+{
+  uint16_t Latency = TCNT1 - OCR;
+
+  if( Latency > SwUartMaxLatency )
+    SwUartMaxLatency = Latency;
+
+  SwUart_Timeout( );
+}
@@ -0,0 +1,36 @@
+/** \file
+ *
+ *  Header file for SoftwareUart.c.
+ */
+
+#ifndef _SOFTWARE_UART_H_
+#define _SOFTWARE_UART_H_
+
+	/* Includes: */
+		#include <avr/io.h>
+		#include <avr/interrupt.h>
+		#include <avr/pgmspace.h>
+		#include <util/atomic.h>
+		#include <stdbool.h>
+		#include <stdint.h>
+
+		#include "Config/AppConfig.h"
+		#include "Timer.h"
+
+	/* Function Prototypes: */
+		void SwUart_Init(void);
+		int16_t SwUart_ReceiveByte(void);
+		uint16_t SwUart_GetBitTicks(void);
+		bool SwUart_IsInverted(void);
+		uint16_t SwUart_GetMaxLatency(void);
+
+		void SwUart_StartCalibration(void);
+		uint8_t SwUart_GetCalibrationEdges(void);
+		bool SwUart_FinishCalibration(void);
+		void SwUart_RestoreCalibration(const uint16_t BitTicks, const bool Inverted);
+
+		#if (SWUART_FRAME_TIMES)
+			bool SwUart_GetFrameTimes(uint16_t* const StartEdge, uint16_t* const Done);
+		#endif
+
+#endif
@@ -0,0 +1,65 @@
+/** \file
+ *
+ *  Stack high-water mark. All RAM between the end of the static variables and the top of the
+ *  stack is painted with \ref STACK_CANARY before main() runs. The stack grows down into that
+ *  area, so the number of bytes still holding the canary is the smallest margin the stack ever
+ *  had, including the nesting of interrupt routines on top of the deepest main loop call.
+ */
+
+#include "StackMonitor.h"
+
+/* Symbols provided by the linker script. */
+extern uint8_t __data_start; //!< Start of the static variables, i.e. RAMSTART.
+extern uint8_t _end;         //!< End of .data, .bss and .noinit.
+extern uint8_t __stack;      //!< Top of the stack, i.e. RAMEND.
+
+void StackMonitor_Paint(void) __attribute__((naked, used, section(".init1")));
+
+/** Paints the free RAM. Runs from the .init1 section, before the stack pointer and the zero
+ *  register are set up, so it must not use either of them.
+ */
+void StackMonitor_Paint(void)
+{
+	__asm volatile ("    ldi r30, lo8(_end)     \n"
+	                "    ldi r31, hi8(_end)     \n"
+	                "    ldi r24, %0            \n"
+	                "    ldi r25, hi8(__stack)  \n"
+	                "    rjmp 2f                \n"
+	                "1:  st Z+, r24             \n"
+	                "2:  cpi r30, lo8(__stack)  \n"
+	                "    cpc r31, r25           \n"
+	                "    brlo 1b                \n"
+	                "    breq 1b                \n"
+	                :: "M" (STACK_CANARY));
+}
+
+/** \return Bytes of RAM taken by static variables. */
+uint16_t StackMonitor_GetStaticRAM(void)
+{
+	return (&_end - &__data_start);
+}
+
+/** Counts the painted bytes that have never been touched. This scans up to the whole free RAM,
+ *  so it should not be called from time critical code.
+ *
+ *  \return Smallest number of bytes ever left between the static variables and the stack.
+ */
+uint16_t StackMonitor_GetUnusedRAM(void)
+{
+	const uint8_t* Position = &_end;
+	uint16_t       Unused   = 0;
+
+	while ((Position <= &__stack) && (*Position == STACK_CANARY))
+	{
+		Position++;
+		Unused++;
+	}
+
+	return Unused;
+}
+
+/** \return Largest number of bytes ever used by the stack. */
+uint16_t StackMonitor_GetMaxStackDepth(void)
+{
+	return (&__stack - &_end + 1) - StackMonitor_GetUnusedRAM();
+}
@@ -0,0 +1,22 @@
+/** \file
+ *
+ *  Header file for StackMonitor.c.
+ */
+
+#ifndef _STACK_MONITOR_H_
+#define _STACK_MONITOR_H_
+
+	/* Includes: */
+		#include <avr/io.h>
+		#include <stdint.h>
+
+	/* Macros: */
+		/** Value free RAM is painted with at startup, bytes still holding it have never been used. */
+		#define STACK_CANARY    0xC5
+
+	/* Function Prototypes: */
+		uint16_t StackMonitor_GetStaticRAM(void);
+		uint16_t StackMonitor_GetUnusedRAM(void);
+		uint16_t StackMonitor_GetMaxStackDepth(void);
+
+#endif
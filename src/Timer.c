@@ -0,0 +1,128 @@
+/** \file
+ *
+ *  Common time base of the firmware. Timer1 runs free with a prescaler chosen at compile time from
+ *  F_CPU and BAUDRATE (see Timer.h); its output compare
+ *  channel A advances in steps of one millisecond to drive the 32-bit millisecond clock, channel B
+ *  is left to the software UART for bit timing. Timer0 is not used.
+ *
+ *  AVR interrupts have no priority levels, an interrupt routine delays all others until it returns.
+ *  The UART interrupts (INT0 and Timer1 compare B) are therefore the only ones of the firmware that
+ *  run with interrupts disabled, the millisecond clock re-enables them on entry. LUFA's USB general
+ *  interrupt cannot be changed, but is kept short: Start-of-Frame events are disabled (NO_SOF_EVENTS)
+ *  and control requests are handled from the main loop, so it only runs on bus events.
+ */
+
+#include "Timer.h"
+
+/** Milliseconds elapsed since \ref Timer_Init() was called. */
+static volatile uint32_t Timer_Milliseconds;
+
+/** The CPU runs at F_CPU / TIMER_IDLE_CLOCK_DIV. */
+volatile bool Timer_SlowClock;
+
+/** Starts Timer1 as the free running time base and enables the millisecond clock. */
+void Timer_Init(void)
+{
+	TIMSK1 = 0;
+	TCCR1A = 0;                  // normal mode, count up to 0xFFFF and wrap
+	TCCR1B = TIMER_CLOCK_SELECT;
+	TCNT1  = 0;
+
+	OCR1A  = TIMER_TICKS_PER_MS;
+	TIFR1  = (1 << OCF1A);       // flags are cleared by writing a one
+	TIMSK1 = (1 << OCIE1A);
+}
+
+/** Returns the number of milliseconds since the timer was started. The value wraps after about
+ *  49 days, so intervals should be computed as the unsigned difference of two readings.
+ */
+uint32_t Timer_GetMilliseconds(void)
+{
+	uint32_t Milliseconds;
+
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+	{
+		Milliseconds = Timer_Milliseconds;
+	}
+
+	return Milliseconds;
+}
+
+/** Converts a Timer1 count into microseconds on the time line of the millisecond clock, i.e.
+ *  Timer_GetMilliseconds() * 1000 plus the fraction of the millisecond. The count must be less than
+ *  32768 ticks old, 16ms at 2MHz. The value wraps after about 71 minutes.
+ */
+uint32_t Timer_TicksToMicroseconds(const uint16_t Ticks)
+{
+	uint32_t Milliseconds;
+	uint16_t NextMillisecond;
+
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+	{
+		Milliseconds    = Timer_Milliseconds;
+		NextMillisecond = OCR1A;
+	}
+
+	/* OCR1A is where the millisecond after the current one starts. Ticks may lie in an earlier
+	 * millisecond, or in a later one if the compare interrupt is still pending */
+	int16_t SinceMillisecond = (int16_t)(Ticks - (uint16_t)(NextMillisecond - TIMER_TICKS_PER_MS));
+
+	/* Avoid the 32-bit division where the tick is a whole fraction or multiple of a microsecond */
+#if ((TIMER_TICKS_PER_SECOND % 1000000) == 0)
+	return (Milliseconds * 1000) + (SinceMillisecond / (int16_t)(TIMER_TICKS_PER_SECOND / 1000000));
+#elif ((1000000 % TIMER_TICKS_PER_SECOND) == 0)
+	return (Milliseconds * 1000) + ((int32_t)SinceMillisecond * (int16_t)(1000000 / TIMER_TICKS_PER_SECOND));
+#else
+	return (Milliseconds * 1000) + (((int32_t)SinceMillisecond * 1000) / (int16_t)TIMER_TICKS_PER_MS);
+#endif
+}
+
+/** Returns the current time on the microsecond time line of \ref Timer_TicksToMicroseconds(). The
+ *  timer and the millisecond clock are read together, so the count cannot age before it is converted.
+ */
+uint32_t Timer_GetMicroseconds(void)
+{
+	uint32_t Microseconds;
+
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+	{
+		Microseconds = Timer_TicksToMicroseconds(TCNT1);
+	}
+
+	return Microseconds;
+}
+
+/** Lowers the CPU clock by TIMER_IDLE_CLOCK_DIV to save power while nothing happens. Timer1's
+ *  prescaler is lowered by the same factor, so the millisecond clock and the UART bit timing are
+ *  not affected. USB keeps working, its PLL is fed from the crystal ahead of the system clock
+ *  prescaler. Whatever detects activity calls \ref Timer_EnterFullClock().
+ */
+void Timer_EnterSlowClock(void)
+{
+	ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+	{
+		/* Lower the timer prescaler first, the timer runs a few ticks too fast rather than too slow */
+		TCCR1B = TIMER_IDLE_CLOCK_SELECT;
+		clock_prescale_set(TIMER_IDLE_CLOCK_PRESCALE);
+		Timer_SlowClock = true;
+	}
+}
+
+/** Millisecond clock: the compare value is moved on by one millisecond worth of ticks, so the
+ *  clock does not drift regardless of how late the interrupt is serviced.
+ *
+ *  The software UART must never wait for this interrupt, so it runs with interrupts enabled. Only
+ *  the OCR1A update is protected: 16-bit timer registers share the TEMP register with the TCNT1
+ *  reads in the UART interrupts. The interrupt cannot nest with itself, as it takes far less than
+ *  the millisecond until its next compare match. The UART interrupts must not read
+ *  Timer_Milliseconds, since they may preempt the increment.
+ */
+ISR(TIMER1_COMPA_vect, ISR_NOBLOCK)
+{
+	ATOMIC_BLOCK(ATOMIC_FORCEON)
+	{
+		OCR1A += TIMER_TICKS_PER_MS;
+	}
+
+	Timer_Milliseconds++;
+}
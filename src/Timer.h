@@ -0,0 +1,102 @@
+/** \file
+ *
+ *  Header file for Timer.c.
+ */
+
+#ifndef _TIMER_H_
+#define _TIMER_H_
+
+	/* Includes: */
+		#include <avr/io.h>
+		#include <avr/interrupt.h>
+		#include <avr/power.h>
+		#include <util/atomic.h>
+		#include <stdbool.h>
+		#include <stdint.h>
+
+		#include "Config/AppConfig.h"
+
+	/* Macros: */
+		/** Timer1 prescalers for the free running time base, one timer tick lasts TIMER_PRESCALER CPU
+		 *  cycles. The finer prescaler is taken unless the software UART could not time a frame at
+		 *  BAUDRATE with signed 16-bit tick differences: from the start bit edge to the middle of the
+		 *  stop bit are 9.5 bits. The millisecond clock needs a whole number of ticks per millisecond.
+		 *
+		 *  While idle the CPU clock is divided by TIMER_IDLE_CLOCK_DIV and the timer prescaler by the same
+		 *  factor, which must leave a prescaler Timer1 has.
+		 */
+		#if (((F_CPU / 8) % 1000) == 0) && (((F_CPU / 8 / BAUDRATE) * 19 / 2) < 32768)
+			#define TIMER_PRESCALER          8
+			#define TIMER_CLOCK_SELECT       (1 << CS11)
+			#define TIMER_IDLE_CLOCK_SELECT  (1 << CS10)
+		#elif (((F_CPU / 64) % 1000) == 0) && (((F_CPU / 64 / BAUDRATE) * 19 / 2) < 32768)
+			#define TIMER_PRESCALER          64
+			#define TIMER_CLOCK_SELECT       ((1 << CS11) | (1 << CS10))
+			#define TIMER_IDLE_CLOCK_SELECT  (1 << CS11)
+		#else
+			#error No Timer1 prescaler gives a whole number of ticks per millisecond and times a frame at BAUDRATE in 16 bits.
+		#endif
+
+		/** Number of Timer1 ticks per second. */
+		#define TIMER_TICKS_PER_SECOND   (F_CPU / TIMER_PRESCALER)
+
+		/** Number of Timer1 ticks per millisecond, this is the period of the OCR1A millisecond clock. */
+		#define TIMER_TICKS_PER_MS       (TIMER_TICKS_PER_SECOND / 1000)
+
+		/** CPU clock divider while the keyboard is idle. Timer1's prescaler is lowered by the same factor,
+		 *  so the timer tick and all timings derived from it stay the same at either clock.
+		 */
+		#define TIMER_IDLE_CLOCK_DIV     8
+
+		/** clock_prescale_set() argument matching TIMER_IDLE_CLOCK_DIV. */
+		#define TIMER_IDLE_CLOCK_PRESCALE  clock_div_8
+
+	/* Function Prototypes: */
+		void Timer_Init(void);
+		uint32_t Timer_GetMilliseconds(void);
+		uint32_t Timer_TicksToMicroseconds(const uint16_t Ticks);
+		uint32_t Timer_GetMicroseconds(void);
+		void Timer_EnterSlowClock(void);
+
+	/* External Variables: */
+		extern volatile bool Timer_SlowClock;
+
+	/* Inline Functions: */
+		/** Returns the current count of the free running Timer1, which is the common timestamp base
+		 *  for everything that needs a finer resolution than the millisecond clock. The value wraps
+		 *  around every 65536 ticks, so only differences of timestamps are meaningful.
+		 *
+		 *  \return Current Timer1 count, in units of \ref TIMER_PRESCALER CPU cycles.
+		 */
+		static inline uint16_t Timer_GetTicks(void)
+		{
+			uint16_t Ticks;
+
+			/* 16-bit timer registers are read through the shared TEMP register */
+			ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+			{
+				Ticks = TCNT1;
+			}
+
+			return Ticks;
+		}
+
+		/** \return true while the CPU runs at the idle clock, see \ref Timer_EnterSlowClock(). */
+		static inline bool Timer_IsSlowClock(void)
+		{
+			return Timer_SlowClock;
+		}
+
+		/** Restores the full CPU clock. Cheap enough to be called from the interrupt that detects activity. */
+		static inline void Timer_EnterFullClock(void)
+		{
+			ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+			{
+				/* Raise the CPU clock first, the timer runs a few ticks too fast rather than too slow */
+				clock_prescale_set(clock_div_1);
+				TCCR1B = TIMER_CLOCK_SELECT;
+				Timer_SlowClock = false;
+			}
+		}
+
+#endif
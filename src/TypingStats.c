@@ -0,0 +1,194 @@
+/** \file
+ *
+ *  On-device typing statistics, enabled with TYPING_STATS (see Config/AppConfig.h). The key
+ *  mapping reports every make and break of a key here, which is turned into per key press
+ *  counts, histograms of hold times and key intervals, and the rollover depth. Nothing but these
+ *  aggregates is kept, in particular not the order of the keys, so the statistics can be read
+ *  out as HID feature reports of the vendor interface without turning the device into a key
+ *  logger. All counters saturate instead of wrapping around.
+ */
+
+#include "TypingStats.h"
+
+#if (TYPING_STATS)
+
+#include <string.h>
+
+#include "Timer.h"
+
+/** Number of keys that can be held down at the same time and still have their hold time measured. */
+#define TYPING_STATS_HELD_KEYS  8
+
+/** A key that is currently held down. */
+typedef struct
+{
+	uint8_t  RawKey;     /**< Raw key code */
+	uint32_t PressTime;  /**< Millisecond clock when the key went down */
+} TypingStats_HeldKey_t;
+
+static TypingStats_Histograms_t  TypingStats_Histograms;
+static TypingStats_PressCounts_t TypingStats_Presses[TYPING_STATS_KEYS / TYPING_STATS_KEYS_PER_REPORT];
+
+static TypingStats_HeldKey_t TypingStats_Held[TYPING_STATS_HELD_KEYS];
+static uint8_t  TypingStats_HeldCount;       //!< Entries of TypingStats_Held in use.
+static uint32_t TypingStats_LastPressTime;   //!< Millisecond clock at the last key press.
+static bool     TypingStats_HavePressed;     //!< TypingStats_LastPressTime is valid.
+
+/** Adds one to a counter unless it is already at its maximum. */
+static inline void TypingStats_Count(uint16_t* const Counter)
+{
+	if (*Counter != UINT16_MAX)
+	  (*Counter)++;
+}
+
+/** \return The milliseconds from \p Then to \p Now, \c UINT16_MAX for anything longer, which still
+ *  lands in the last histogram bucket.
+ */
+static inline uint16_t TypingStats_Elapsed(const uint32_t Now, const uint32_t Then)
+{
+	uint32_t Milliseconds = Now - Then;
+
+	return (Milliseconds > UINT16_MAX) ? UINT16_MAX : Milliseconds;
+}
+
+/** \return The histogram bucket of a duration, see \ref TYPING_STATS_TIME_BUCKETS. Not inlined, so
+ *  that `make wcet-check` can bound its loop apart from the loop over the held keys.
+ */
+static uint8_t ATTR_NO_INLINE TypingStats_TimeBucket(uint16_t Milliseconds)
+{
+	uint8_t Bucket = 0;
+
+	while (Milliseconds && (Bucket < (TYPING_STATS_TIME_BUCKETS - 1)))
+	{
+		Milliseconds >>= 1;
+		Bucket++;
+	}
+
+	return Bucket;
+}
+
+/** Records a key going down.
+ *
+ *  \param[in] RawKey  Raw key code sent by the keyboard, without the break flag
+ */
+void TypingStats_KeyPressed(const uint8_t RawKey)
+{
+	uint32_t Now = Timer_GetMilliseconds();
+
+	TypingStats_Count(&TypingStats_Presses[(RawKey / TYPING_STATS_KEYS_PER_REPORT) & 1].Presses[RawKey % TYPING_STATS_KEYS_PER_REPORT]);
+
+	if (TypingStats_HavePressed)
+	  TypingStats_Count(&TypingStats_Histograms.KeyInterval[TypingStats_TimeBucket(TypingStats_Elapsed(Now, TypingStats_LastPressTime))]);
+	TypingStats_LastPressTime = Now;
+	TypingStats_HavePressed   = true;
+
+	uint8_t Depth = TypingStats_HeldCount;
+	if (Depth >= TYPING_STATS_ROLLOVER_BUCKETS)
+	  Depth = TYPING_STATS_ROLLOVER_BUCKETS - 1;
+	TypingStats_Count(&TypingStats_Histograms.Rollover[Depth]);
+
+	if (TypingStats_HeldCount < TYPING_STATS_HELD_KEYS)
+	{
+		TypingStats_Held[TypingStats_HeldCount].RawKey    = RawKey;
+		TypingStats_Held[TypingStats_HeldCount].PressTime = Now;
+		TypingStats_HeldCount++;
+	}
+}
+
+/** Records a key going up.
+ *
+ *  \param[in] RawKey  Raw key code sent by the keyboard, without the break flag
+ */
+void TypingStats_KeyReleased(const uint8_t RawKey)
+{
+	uint32_t Now = Timer_GetMilliseconds();
+
+	for (uint8_t i = 0; i < TypingStats_HeldCount; i++)
+	{
+		if (TypingStats_Held[i].RawKey == RawKey)
+		{
+			TypingStats_Count(&TypingStats_Histograms.HoldTime[TypingStats_TimeBucket(TypingStats_Elapsed(Now, TypingStats_Held[i].PressTime))]);
+
+			TypingStats_HeldCount--;
+			TypingStats_Held[i] = TypingStats_Held[TypingStats_HeldCount];
+			break;
+		}
+	}
+}
+
+/** Forgets all held keys, e.g. when the keyboard reports that all keys are up or the link is lost. */
+void TypingStats_AllReleased(void)
+{
+	TypingStats_HeldCount = 0;
+}
+
+/** Clears all statistics, and sets up the report headers they are kept in. */
+void TypingStats_Init(void)
+{
+	memset(&TypingStats_Histograms, 0, sizeof(TypingStats_Histograms));
+	memset(TypingStats_Presses, 0, sizeof(TypingStats_Presses));
+	TypingStats_HavePressed = false;
+
+	TypingStats_Histograms.ReportID  = TYPING_STATS_REPORTID_Histograms;
+	TypingStats_Histograms.Version   = 1;
+	TypingStats_Presses[0].ReportID  = TYPING_STATS_REPORTID_PressCountsLow;
+	TypingStats_Presses[1].ReportID  = TYPING_STATS_REPORTID_PressCountsHigh;
+}
+
+/** Answers Get Report requests for the statistics feature reports, and clears the statistics on a
+ *  Set Report of \ref TYPING_STATS_REPORTID_Histograms.
+ *
+ *  \param[in] ReportID  Feature report requested on the vendor interface, see VendorInterface_FeatureReportID()
+ */
+void TypingStats_ProcessFeatureReport(const uint8_t ReportID)
+{
+	/* The statistics are kept in the report layout, they are sent without a copy */
+	const void* Report;
+	uint16_t    ReportSize;
+
+	switch (USB_ControlRequest.bRequest)
+	{
+		case HID_REQ_GetReport:
+			if (ReportID == TYPING_STATS_REPORTID_Histograms)
+			{
+				Report     = &TypingStats_Histograms;
+				ReportSize = sizeof(TypingStats_Histograms);
+			}
+			else if (ReportID == TYPING_STATS_REPORTID_PressCountsLow)
+			{
+				Report     = &TypingStats_Presses[0];
+				ReportSize = sizeof(TypingStats_PressCounts_t);
+			}
+			else if (ReportID == TYPING_STATS_REPORTID_PressCountsHigh)
+			{
+				Report     = &TypingStats_Presses[1];
+				ReportSize = sizeof(TypingStats_PressCounts_t);
+			}
+			else
+			{
+				break;
+			}
+
+			Endpoint_ClearSETUP();
+			Endpoint_Write_Control_Stream_LE(Report, ReportSize);
+			Endpoint_ClearOUT();
+
+			break;
+		case HID_REQ_SetReport:
+			if ((ReportID != TYPING_STATS_REPORTID_Histograms) ||
+			    (USB_ControlRequest.wLength > sizeof(TypingStats_Histograms)))
+			{
+				break;
+			}
+
+			/* The content of the report does not matter, writing it is the request to start over */
+			Endpoint_ClearSETUP();
+			Endpoint_Read_Control_Stream_LE(&TypingStats_Histograms, USB_ControlRequest.wLength);
+			Endpoint_ClearIN();
+			TypingStats_Init();
+
+			break;
+	}
+}
+
+#endif
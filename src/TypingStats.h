@@ -0,0 +1,75 @@
+/** \file
+ *
+ *  Header file for TypingStats.c.
+ */
+
+#ifndef _TYPING_STATS_H_
+#define _TYPING_STATS_H_
+
+	/* Includes: */
+		#include <stdbool.h>
+		#include <stdint.h>
+
+		#include "Config/AppConfig.h"
+		#include "Descriptors.h"
+
+	/* Macros: */
+		/** Number of log2 spaced millisecond buckets of the hold time and key interval histograms,
+		 *  bucket n counts durations from 2^(n-1) up to 2^n - 1 ms, bucket 0 durations below 1ms.
+		 *  The last bucket also takes everything longer.
+		 */
+		#define TYPING_STATS_TIME_BUCKETS      16
+
+		/** Number of buckets of the rollover histogram, bucket n counts key presses that came while
+		 *  n other keys were held down. The last bucket also takes deeper rollover.
+		 */
+		#define TYPING_STATS_ROLLOVER_BUCKETS  8
+
+		/** Number of raw key codes, i.e. the 7-bit matrix position sent by the keyboard. */
+		#define TYPING_STATS_KEYS              128
+
+		/** Keys per press count report, the counts are split over two reports to keep them small. */
+		#define TYPING_STATS_KEYS_PER_REPORT   (TYPING_STATS_KEYS / 2)
+
+		/** Report ID of \ref TypingStats_Histograms_t. Writing it (Set Report) clears all statistics. */
+		#define TYPING_STATS_REPORTID_Histograms  0x01
+
+		/** Report ID of the press counts of raw key codes 0 to 63, see \ref TypingStats_PressCounts_t. */
+		#define TYPING_STATS_REPORTID_PressCountsLow  0x02
+
+		/** Report ID of the press counts of raw key codes 64 to 127, see \ref TypingStats_PressCounts_t. */
+		#define TYPING_STATS_REPORTID_PressCountsHigh 0x03
+
+	/* Type Defines: */
+		/** Feature report with the timing histograms. All counters are little endian and saturate at 65535. */
+		typedef struct
+		{
+			uint8_t  ReportID;                                 /**< \ref TYPING_STATS_REPORTID_Histograms */
+			uint8_t  Version;                                  /**< Layout version of this report, currently 1 */
+			uint16_t HoldTime[TYPING_STATS_TIME_BUCKETS];      /**< Time from press to release of a key */
+			uint16_t KeyInterval[TYPING_STATS_TIME_BUCKETS];   /**< Time from one key press to the next */
+			uint16_t Rollover[TYPING_STATS_ROLLOVER_BUCKETS];  /**< Keys held down when another one was pressed */
+		} ATTR_PACKED TypingStats_Histograms_t;
+
+		/** Feature report with the number of presses per raw key code. */
+		typedef struct
+		{
+			uint8_t  ReportID;                                 /**< One of the TYPING_STATS_REPORTID_PressCounts* IDs */
+			uint16_t Presses[TYPING_STATS_KEYS_PER_REPORT];    /**< Saturating press counts */
+		} ATTR_PACKED TypingStats_PressCounts_t;
+
+	/* Function Prototypes: */
+		#if (TYPING_STATS)
+			void TypingStats_Init(void);
+			void TypingStats_KeyPressed(const uint8_t RawKey);
+			void TypingStats_KeyReleased(const uint8_t RawKey);
+			void TypingStats_AllReleased(void);
+			void TypingStats_ProcessFeatureReport(const uint8_t ReportID);
+		#else
+			static inline void TypingStats_Init(void) {}
+			static inline void TypingStats_KeyPressed(const uint8_t RawKey) {}
+			static inline void TypingStats_KeyReleased(const uint8_t RawKey) {}
+			static inline void TypingStats_AllReleased(void) {}
+		#endif
+
+#endif
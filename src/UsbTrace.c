@@ -0,0 +1,130 @@
+/** \file
+ *
+ *  USB transaction trace, enabled with USB_TRACE (see Config/AppConfig.h). Every control request
+ *  the device receives, including the standard requests of the enumeration, and every report
+ *  written to the keyboard and vendor IN endpoints is recorded with a microsecond timestamp of the
+ *  device's clock. The records are read as feature reports of the vendor interface by
+ *  tools/usb_trace.py, which writes them to a pcap file in the Linux usbmon format for Wireshark.
+ *
+ *  Only what the firmware sees is recorded: the setup packet, the size of the data stage (for
+ *  descriptors the size actually returned) and whether the request was stalled, and the first
+ *  USB_TRACE_DATA_SIZE bytes of a report at the time it was written into the endpoint bank. The
+ *  bytes of a control data stage, descriptors included, are not kept. The reads of the trace
+ *  itself are left out. Records are kept from power up until they are read, so the enumeration is
+ *  in the first reports.
+ */
+
+#include "UsbTrace.h"
+
+#if (USB_TRACE)
+
+#include <string.h>
+
+#include "Timer.h"
+#include "VendorInterface.h"
+
+/** Records kept until the host reads them, must be a power of two. Holds a full enumeration. */
+#define USB_TRACE_QUEUE_SIZE  32
+
+static UsbTrace_Record_t UsbTrace_Records[USB_TRACE_QUEUE_SIZE];
+static VendorQueue_t UsbTrace_Queue = VENDOR_QUEUE(UsbTrace_Records);
+static UsbTrace_Record_t* UsbTrace_Request;   //!< Record of the control request being handled, NULL if it was dropped.
+
+/** Takes the next free record, stamped with the current time.
+ *
+ *  \return The record, or NULL if the queue is full.
+ */
+static UsbTrace_Record_t* UsbTrace_Add(const uint8_t Endpoint, const uint16_t Length)
+{
+	UsbTrace_Record_t* Record = VendorQueue_Add(&UsbTrace_Queue);
+	if (Record == NULL)
+	  return NULL;
+
+	Record->Microseconds = Timer_GetMicroseconds();
+	Record->Endpoint     = Endpoint;
+	Record->Length       = Length;
+	return Record;
+}
+
+/** true for the Get Report requests that read the trace. */
+static bool UsbTrace_IsTraceRead(void)
+{
+	return ((USB_ControlRequest.bRequest == HID_REQ_GetReport) &&
+	        (VendorInterface_FeatureReportID() == USB_TRACE_REPORTID));
+}
+
+/** Records the setup packet of a control request, called before anything handles it. */
+void UsbTrace_ControlRequest(void)
+{
+	UsbTrace_Request = NULL;
+
+	if (UsbTrace_IsTraceRead())
+	  return;
+
+	UsbTrace_Request = UsbTrace_Add(0, USB_ControlRequest.wLength);
+	if (UsbTrace_Request != NULL)
+	  memcpy(UsbTrace_Request->Data, &USB_ControlRequest, USB_TRACE_DATA_SIZE);
+}
+
+/** Notes the size of the descriptor returned for the current Get Descriptor request.
+ *
+ *  \param[in] Size  Size of the descriptor, NO_DESCRIPTOR if there is none and the request is stalled
+ */
+void UsbTrace_Descriptor(const uint16_t Size)
+{
+	if ((UsbTrace_Request != NULL) && (Size < UsbTrace_Request->Length))
+	  UsbTrace_Request->Length = Size;
+}
+
+/** Records a report written to an IN endpoint.
+ *
+ *  \param[in] Endpoint  Address of the endpoint
+ *  \param[in] Report    Report as written, its first USB_TRACE_DATA_SIZE bytes are kept
+ *  \param[in] Length    Size of the report
+ */
+void UsbTrace_ReportWritten(const uint8_t Endpoint, const void* const Report, const uint16_t Length)
+{
+	UsbTrace_Record_t* Record = UsbTrace_Add(Endpoint, Length);
+	if (Record == NULL)
+	  return;
+
+	memset(Record->Data, 0, USB_TRACE_DATA_SIZE);
+	memcpy(Record->Data, Report, (Length < USB_TRACE_DATA_SIZE) ? Length : USB_TRACE_DATA_SIZE);
+}
+
+/** Completes the record of the control request handled by the last USB_USBTask(), which stalls the
+ *  control endpoint for a request nobody answered.
+ */
+void UsbTrace_Task(void)
+{
+	if (UsbTrace_Request == NULL)
+	  return;
+
+	uint8_t PrevEndpoint = Endpoint_GetCurrentEndpoint();
+
+	Endpoint_SelectEndpoint(ENDPOINT_CONTROLEP);
+	if (Endpoint_IsStalled())
+	{
+		UsbTrace_Request->Endpoint = USB_TRACE_CONTROL_Stalled;
+		UsbTrace_Request->Length   = 0;
+	}
+
+	Endpoint_SelectEndpoint(PrevEndpoint);
+	UsbTrace_Request = NULL;
+}
+
+/** Answers Get Report requests for \ref USB_TRACE_REPORTID with the oldest records, which are then
+ *  forgotten.
+ *
+ *  \param[in] ReportID  Feature report requested on the vendor interface, see VendorInterface_FeatureReportID()
+ */
+void UsbTrace_ProcessFeatureReport(const uint8_t ReportID)
+{
+	if ((ReportID != USB_TRACE_REPORTID) || (USB_ControlRequest.bRequest != HID_REQ_GetReport))
+	  return;
+
+	UsbTrace_Report_t Report;
+	VendorQueue_SendReport(&UsbTrace_Queue, USB_TRACE_REPORTID, &Report, sizeof(Report));
+}
+
+#endif
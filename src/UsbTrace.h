@@ -0,0 +1,64 @@
+/** \file
+ *
+ *  Header file for UsbTrace.c.
+ */
+
+#ifndef _USB_TRACE_H_
+#define _USB_TRACE_H_
+
+	/* Includes: */
+		#include <stdbool.h>
+		#include <stdint.h>
+
+		#include "Config/AppConfig.h"
+		#include "Descriptors.h"
+
+	/* Macros: */
+		/** Report ID of \ref UsbTrace_Report_t on the vendor interface. */
+		#define USB_TRACE_REPORTID            0x07
+
+		/** Number of records per report, more are kept on the device until the next report. */
+		#define USB_TRACE_RECORDS_PER_REPORT  6
+
+		/** Bytes of a setup packet, and of a report kept in a record. */
+		#define USB_TRACE_DATA_SIZE           8
+
+		/** Endpoint of the record of a control request the device stalled. */
+		#define USB_TRACE_CONTROL_Stalled     0x40
+
+	/* Type Defines: */
+		/** One control request handled, or one report written to an IN endpoint. */
+		typedef struct
+		{
+			uint32_t Microseconds;  /**< Time the firmware handled the request or wrote the report, see Timer_GetMicroseconds() */
+			uint8_t  Endpoint;      /**< 0 for a control request, \ref USB_TRACE_CONTROL_Stalled if it was stalled, otherwise the address of the IN endpoint */
+			uint16_t Length;        /**< Control request: size of its data stage, wLength or the size of the descriptor returned for it, 0 if stalled. Report: its size */
+			uint8_t  Data[USB_TRACE_DATA_SIZE]; /**< Setup packet, or the first bytes of the report */
+		} ATTR_PACKED UsbTrace_Record_t;
+
+		/** Feature report with the records traced since the previous one, oldest first. Starts like a
+		 *  \ref VendorReport_Header_t.
+		 */
+		typedef struct
+		{
+			uint8_t ReportID;   /**< \ref USB_TRACE_REPORTID */
+			uint8_t Count;      /**< Valid entries of Records */
+			uint8_t Lost;       /**< Records dropped since the previous report because nobody read them, saturating */
+			UsbTrace_Record_t Records[USB_TRACE_RECORDS_PER_REPORT];
+		} ATTR_PACKED UsbTrace_Report_t;
+
+	/* Function Prototypes: */
+		#if (USB_TRACE)
+			void UsbTrace_ControlRequest(void);
+			void UsbTrace_Descriptor(const uint16_t Size);
+			void UsbTrace_ReportWritten(const uint8_t Endpoint, const void* const Report, const uint16_t Length);
+			void UsbTrace_Task(void);
+			void UsbTrace_ProcessFeatureReport(const uint8_t ReportID);
+		#else
+			static inline void UsbTrace_ControlRequest(void) {}
+			static inline void UsbTrace_Descriptor(const uint16_t Size) {}
+			static inline void UsbTrace_ReportWritten(const uint8_t Endpoint, const void* const Report, const uint16_t Length) {}
+			static inline void UsbTrace_Task(void) {}
+		#endif
+
+#endif
@@ -0,0 +1,162 @@
+/** \file
+ *
+ *  Vendor specific HID interface, present with VENDOR_INTERFACE (see Config/AppConfig.h). It carries
+ *  the reports of the optional features, each with its own report IDs:
+ *
+ *  - TypingStats.c   feature reports 1 to 3
+ *  - LatencyProbe.c  feature report 4
+ *  - RawEvents.c     input report 5, feature report 6
+ *  - UsbTrace.c      feature report 7
+ *
+ *  The Get Report and Set Report requests for feature reports are filtered here and handed to the
+ *  features by report ID. Features that collect entries until the host reads them keep them in a
+ *  \ref VendorQueue_t, which also builds the reports.
+ *
+ *  Everything behind the vendor interface runs from the main loop, control requests are handled
+ *  by USB_USBTask() and not in the USB interrupt, so no data is shared with interrupts.
+ */
+
+#include "VendorInterface.h"
+
+#if (VENDOR_INTERFACE)
+
+#include <string.h>
+
+#include "TypingStats.h"
+#include "LatencyProbe.h"
+#include "RawEvents.h"
+#include "UsbTrace.h"
+
+/** \return The report ID of a Get Report or Set Report request for a feature report of the vendor
+ *  interface, 0 for any other request.
+ */
+uint8_t VendorInterface_FeatureReportID(void)
+{
+	if ((USB_ControlRequest.wIndex != INTERFACE_ID_Vendor) ||
+	    (((USB_ControlRequest.wValue >> 8) - 1) != HID_REPORT_ITEM_Feature))
+	{
+		return 0;
+	}
+
+	switch (USB_ControlRequest.bRequest)
+	{
+		case HID_REQ_GetReport:
+			if (USB_ControlRequest.bmRequestType != (REQDIR_DEVICETOHOST | REQTYPE_CLASS | REQREC_INTERFACE))
+			  return 0;
+
+			break;
+		case HID_REQ_SetReport:
+			if (USB_ControlRequest.bmRequestType != (REQDIR_HOSTTODEVICE | REQTYPE_CLASS | REQREC_INTERFACE))
+			  return 0;
+
+			break;
+		default:
+			return 0;
+	}
+
+	return (USB_ControlRequest.wValue & 0xFF);
+}
+
+/** Hands a feature report request of the vendor interface to the feature it belongs to. */
+void VendorInterface_ProcessControlRequest(void)
+{
+	const uint8_t ReportID = VendorInterface_FeatureReportID();
+
+	if (!(ReportID))
+	  return;
+
+#if (TYPING_STATS)
+	TypingStats_ProcessFeatureReport(ReportID);
+#endif
+#if (LATENCY_PROBE)
+	LatencyProbe_ProcessFeatureReport(ReportID);
+#endif
+#if (RAW_EVENTS)
+	RawEvents_ProcessFeatureReport(ReportID);
+#endif
+#if (USB_TRACE)
+	UsbTrace_ProcessFeatureReport(ReportID);
+#endif
+}
+
+/** Forgets all entries of a queue. */
+void VendorQueue_Clear(VendorQueue_t* const Queue)
+{
+	Queue->Head = Queue->Tail = 0;
+	Queue->Lost = 0;
+}
+
+/** \return true if the queue has no entries to report. */
+bool VendorQueue_IsEmpty(const VendorQueue_t* const Queue)
+{
+	return (Queue->Head == Queue->Tail);
+}
+
+/** Takes the next free entry of a queue, the caller fills it in.
+ *
+ *  \return The entry, or NULL if the queue is full. The entry is then counted as lost.
+ */
+void* VendorQueue_Add(VendorQueue_t* const Queue)
+{
+	uint8_t Next = (Queue->Head + 1) & Queue->Mask;
+	if (Next == Queue->Tail)
+	{
+		VendorQueue_Drop(Queue);
+		return NULL;
+	}
+
+	void* Entry = &Queue->Entries[Queue->Head * Queue->EntrySize];
+	Queue->Head = Next;
+	return Entry;
+}
+
+/** Counts an entry that could not be kept, it is reported as lost with the next report. */
+void VendorQueue_Drop(VendorQueue_t* const Queue)
+{
+	if (Queue->Lost != UINT8_MAX)
+	  Queue->Lost++;
+}
+
+/** Moves the oldest entries of a queue into a report, as many as it has room for.
+ *
+ *  \param[in,out] Queue       Queue to take the entries from
+ *  \param[in]     ReportID    Report ID to put into the header
+ *  \param[out]    Report      A \ref VendorReport_Header_t followed by room for the entries
+ *  \param[in]     ReportSize  Size of the report, unused entries are sent as zeros
+ */
+void VendorQueue_FillReport(VendorQueue_t* const Queue, const uint8_t ReportID, void* const Report,
+                            const uint16_t ReportSize)
+{
+	VendorReport_Header_t* Header = Report;
+	uint8_t* Entry = (uint8_t*)Report + sizeof(VendorReport_Header_t);
+	uint8_t  Room  = (ReportSize - sizeof(VendorReport_Header_t)) / Queue->EntrySize;
+
+	memset(Report, 0, ReportSize);
+	Header->ReportID = ReportID;
+	Header->Lost     = Queue->Lost;
+
+	while ((Header->Count < Room) && (Queue->Tail != Queue->Head))
+	{
+		memcpy(Entry, &Queue->Entries[Queue->Tail * Queue->EntrySize], Queue->EntrySize);
+		Entry += Queue->EntrySize;
+		Header->Count++;
+		Queue->Tail = (Queue->Tail + 1) & Queue->Mask;
+	}
+
+	Queue->Lost = 0;
+}
+
+/** Answers the current Get Report request with the oldest entries of a queue, which are then
+ *  forgotten, see \ref VendorQueue_FillReport().
+ */
+void VendorQueue_SendReport(VendorQueue_t* const Queue, const uint8_t ReportID, void* const Report,
+                            const uint16_t ReportSize)
+{
+	VendorQueue_FillReport(Queue, ReportID, Report, ReportSize);
+
+	Endpoint_ClearSETUP();
+	Endpoint_Write_Control_Stream_LE(Report, ReportSize);
+	Endpoint_ClearOUT();
+}
+
+#endif
@@ -0,0 +1,63 @@
+/** \file
+ *
+ *  Header file for VendorInterface.c.
+ */
+
+#ifndef _VENDOR_INTERFACE_H_
+#define _VENDOR_INTERFACE_H_
+
+	/* Includes: */
+		#include <stdbool.h>
+		#include <stddef.h>
+		#include <stdint.h>
+
+		#include "Config/AppConfig.h"
+		#include "Descriptors.h"
+
+	/* Macros: */
+		/** Initializer of a \ref VendorQueue_t holding the entries of the array \p Array, whose length must
+		 *  be a power of two.
+		 */
+		#define VENDOR_QUEUE(Array)  { .Entries = (uint8_t*)(Array), .EntrySize = sizeof((Array)[0]), \
+		                               .Mask = (sizeof(Array) / sizeof((Array)[0])) - 1 }
+
+	/* Type Defines: */
+		/** Start of the reports that hand out the entries of a \ref VendorQueue_t, followed by the entries. */
+		typedef struct
+		{
+			uint8_t ReportID;   /**< Report ID */
+			uint8_t Count;      /**< Valid entries following the header, the rest of the report is zero */
+			uint8_t Lost;       /**< Entries dropped since the previous report, saturating */
+		} ATTR_PACKED VendorReport_Header_t;
+
+		/** Entries kept until the host reads them. The oldest are handed out first, new ones are dropped
+		 *  and counted while the queue is full.
+		 */
+		typedef struct
+		{
+			uint8_t* Entries;   /**< Storage of the entries */
+			uint8_t EntrySize;  /**< Bytes per entry */
+			uint8_t Mask;       /**< Number of entries minus one */
+			uint8_t Head;       /**< Next free entry */
+			uint8_t Tail;       /**< Oldest entry not yet reported */
+			uint8_t Lost;       /**< Entries dropped since the last report, saturating */
+		} VendorQueue_t;
+
+	/* Function Prototypes: */
+		#if (VENDOR_INTERFACE)
+			uint8_t VendorInterface_FeatureReportID(void);
+			void VendorInterface_ProcessControlRequest(void);
+
+			void VendorQueue_Clear(VendorQueue_t* const Queue);
+			bool VendorQueue_IsEmpty(const VendorQueue_t* const Queue);
+			void* VendorQueue_Add(VendorQueue_t* const Queue);
+			void VendorQueue_Drop(VendorQueue_t* const Queue);
+			void VendorQueue_FillReport(VendorQueue_t* const Queue, const uint8_t ReportID, void* const Report,
+			                            const uint16_t ReportSize);
+			void VendorQueue_SendReport(VendorQueue_t* const Queue, const uint8_t ReportID, void* const Report,
+			                            const uint16_t ReportSize);
+		#else
+			static inline void VendorInterface_ProcessControlRequest(void) {}
+		#endif
+
+#endif
@@ -0,0 +1,97 @@
+/** \file
+ *
+ *  State kept across a watchdog reset. The block lives in .noinit, which the C runtime neither
+ *  clears nor initialises, so its contents survive any reset that keeps the supply up. A magic
+ *  number and a CRC tell a block written by \ref WarmStart_Save() from the random RAM contents
+ *  after a power up. \ref WarmStart_Restore() consumes the block, a fault while resuming from it
+ *  therefore ends in a full boot.
+ */
+
+#include "WarmStart.h"
+
+#include <stddef.h>
+#include <util/crc16.h>
+
+/** Marks a block written by this firmware, changed along with the layout of WarmStart_State_t. */
+#define WARMSTART_MAGIC  0x5701
+
+/** The saved state as it is kept in RAM. */
+typedef struct
+{
+	uint16_t Magic;                 /**< \ref WARMSTART_MAGIC */
+	WarmStart_State_t State;
+	uint16_t CRC;                   /**< CRC-CCITT of Magic and State */
+} WarmStart_Block_t;
+
+static WarmStart_Block_t WarmStart_Block __attribute__((section(".noinit")));
+
+/** MCUSR as found at startup, kept in .noinit as the C runtime clears .bss only after it was read. */
+static uint8_t WarmStart_ResetFlags __attribute__((section(".noinit")));
+
+void WarmStart_DisableWatchdog(void) __attribute__((naked, used, section(".init3")));
+
+/** Stops the watchdog before the C runtime initialises the static variables. After a watchdog
+ *  reset it keeps running with its shortest timeout, which would reset the device again before
+ *  main() gets to it. Runs from the .init3 section, the stack and the zero register are set up.
+ */
+void WarmStart_DisableWatchdog(void)
+{
+	WarmStart_ResetFlags = MCUSR;
+	MCUSR = 0;
+	wdt_disable();
+}
+
+/** \return CRC of the block up to its CRC field. */
+static uint16_t WarmStart_CRC(void)
+{
+	const uint8_t* Data = (const uint8_t*)&WarmStart_Block;
+	uint16_t CRC = 0xFFFF;
+
+	for (uint8_t i = 0; i < offsetof(WarmStart_Block_t, CRC); i++)
+	  CRC = _crc_ccitt_update(CRC, Data[i]);
+
+	return CRC;
+}
+
+/** Stores the state a restart should resume from, replacing the previous one. */
+void WarmStart_Save(const WarmStart_State_t* const State)
+{
+	WarmStart_Block.Magic = WARMSTART_MAGIC;
+	WarmStart_Block.State = *State;
+	WarmStart_Block.CRC   = WarmStart_CRC();
+}
+
+/** \return true if the block holds a state saved before the last reset. */
+bool WarmStart_IsValid(void)
+{
+	return ((WarmStart_Block.Magic == WARMSTART_MAGIC) && (WarmStart_Block.CRC == WarmStart_CRC()));
+}
+
+/** Fetches the state saved before the last reset, and invalidates it.
+ *
+ *  \param[out] State  Saved state, only written if there is one
+ *
+ *  \return true if a state was saved, false after a power up or if nothing was worth resuming.
+ */
+bool WarmStart_Restore(WarmStart_State_t* const State)
+{
+	bool Valid = WarmStart_IsValid();
+
+	if (Valid)
+	  *State = WarmStart_Block.State;
+
+	WarmStart_Invalidate();
+	return Valid;
+}
+
+/** Forgets the saved state, e.g. once the keyboard it describes has gone. */
+void WarmStart_Invalidate(void)
+{
+	WarmStart_Block.Magic = 0;
+}
+
+/** \return MCUSR at startup, i.e. the cause of the last reset. Bootloaders may have cleared it. */
+uint8_t WarmStart_GetResetFlags(void)
+{
+	return WarmStart_ResetFlags;
+}
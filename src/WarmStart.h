@@ -0,0 +1,34 @@
+/** \file
+ *
+ *  Header file for WarmStart.c.
+ */
+
+#ifndef _WARM_START_H_
+#define _WARM_START_H_
+
+	/* Includes: */
+		#include <avr/io.h>
+		#include <avr/wdt.h>
+		#include <stdbool.h>
+		#include <stdint.h>
+
+		#include "KeyMap.h"
+
+	/* Type Defines: */
+		/** What the firmware needs to pick up a running keyboard after a watchdog reset. */
+		typedef struct
+		{
+			KeyMap_t KeyMap;        /**< Keys held at the time, they are released to the host on the resume */
+			uint8_t  Driver;        /**< Index of the keyboard driver selected from the id string */
+			uint16_t UartBitTicks;  /**< Bit period measured from the id string, see SwUart_FinishCalibration() */
+			bool     UartInverted;  /**< Line polarity measured from the id string */
+		} WarmStart_State_t;
+
+	/* Function Prototypes: */
+		void WarmStart_Save(const WarmStart_State_t* const State);
+		bool WarmStart_IsValid(void);
+		bool WarmStart_Restore(WarmStart_State_t* const State);
+		void WarmStart_Invalidate(void);
+		uint8_t WarmStart_GetResetFlags(void);
+
+#endif
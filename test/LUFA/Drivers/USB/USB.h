@@ -0,0 +1,52 @@
+/* The parts of LUFA's USB driver used by the firmware modules under test. Descriptor types are
+ * opaque, the control request and the endpoint functions are implemented by the tests.
+ */
+
+#ifndef _TEST_LUFA_USB_H_
+#define _TEST_LUFA_USB_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define ATTR_PACKED                 __attribute__ ((packed))
+#define ATTR_WARN_UNUSED_RESULT     __attribute__ ((warn_unused_result))
+#define ATTR_NON_NULL_PTR_ARG(...)  __attribute__ ((nonnull (__VA_ARGS__)))
+
+typedef struct { uint8_t Bytes[9]; } USB_Descriptor_Configuration_Header_t;
+typedef struct { uint8_t Bytes[9]; } USB_Descriptor_Interface_t;
+typedef struct { uint8_t Bytes[9]; } USB_HID_Descriptor_HID_t;
+typedef struct { uint8_t Bytes[7]; } USB_Descriptor_Endpoint_t;
+
+typedef struct
+{
+  uint8_t  bmRequestType;
+  uint8_t  bRequest;
+  uint16_t wValue;
+  uint16_t wIndex;
+  uint16_t wLength;
+} ATTR_PACKED USB_Request_Header_t;
+
+#define ENDPOINT_DIR_IN             0x80
+
+#define REQDIR_HOSTTODEVICE         (0 << 7)
+#define REQDIR_DEVICETOHOST         (1 << 7)
+#define REQTYPE_CLASS               (1 << 5)
+#define REQREC_INTERFACE            (1 << 0)
+
+#define HID_REQ_GetReport           0x01
+#define HID_REQ_SetReport           0x09
+#define HID_REPORT_ITEM_Feature     2
+
+enum { DEVICE_STATE_Unattached, DEVICE_STATE_Powered, DEVICE_STATE_Default, DEVICE_STATE_Addressed,
+       DEVICE_STATE_Configured, DEVICE_STATE_Suspended };
+
+extern USB_Request_Header_t USB_ControlRequest;
+extern volatile uint8_t USB_DeviceState;
+
+void Endpoint_SelectEndpoint(const uint8_t Address);
+bool Endpoint_IsINReady(void);
+void Endpoint_ClearSETUP(void);
+void Endpoint_ClearOUT(void);
+uint8_t Endpoint_Write_Control_Stream_LE(const void* const Buffer, uint16_t Length);
+
+#endif
@@ -0,0 +1,8 @@
+/* Interrupt routines become plain functions the test calls. */
+
+#ifndef _TEST_AVR_INTERRUPT_H_
+#define _TEST_AVR_INTERRUPT_H_
+
+#define ISR(vector, ...) void vector(void)
+
+#endif
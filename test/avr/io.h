@@ -0,0 +1,19 @@
+/* Registers of the ATmega32U4 used by the firmware modules under test, as plain variables. */
+
+#ifndef _TEST_AVR_IO_H_
+#define _TEST_AVR_IO_H_
+
+#include <stdint.h>
+
+extern uint8_t PIND, PORTD, DDRD, EIMSK, EIFR, EICRA, TIMSK1, TIFR1, TCCR1B;
+extern uint16_t TCNT1, OCR1B;
+
+#define INT0   0
+#define INTF0  0
+#define ISC00  0
+#define OCIE1B 2
+#define OCF1B  2
+#define CS10   0
+#define CS11   1
+
+#endif
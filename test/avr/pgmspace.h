@@ -0,0 +1,7 @@
+#ifndef _TEST_AVR_PGMSPACE_H_
+#define _TEST_AVR_PGMSPACE_H_
+
+#define PROGMEM
+#define pgm_read_word(address) (*(address))
+
+#endif
@@ -0,0 +1,8 @@
+#ifndef _TEST_AVR_POWER_H_
+#define _TEST_AVR_POWER_H_
+
+#define clock_div_1 0
+#define clock_div_8 3
+#define clock_prescale_set(div) ((void)(div))
+
+#endif
@@ -0,0 +1,222 @@
+/** \file
+ *
+ *  Host test of the latency probe (../src/LatencyProbe.c) and the report queue it uses
+ *  (../src/VendorInterface.c). The timer, the software UART's frame times and the keyboard
+ *  endpoint are set by the test, the records are read back through a Get Report request as
+ *  tools/latency_probe.py does.
+ *
+ *    make check
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "LatencyProbe.h"
+#include "VendorInterface.h"
+
+uint8_t PIND, PORTD, DDRD, EIMSK, EIFR, EICRA, TIMSK1, TIFR1, TCCR1B;
+uint16_t TCNT1, OCR1B;
+volatile bool Timer_SlowClock;
+
+USB_Request_Header_t USB_ControlRequest;
+volatile uint8_t USB_DeviceState = DEVICE_STATE_Configured;
+
+/** The keyboard endpoint's bank has been fetched by the host. */
+static bool INReady;
+
+/** Reception times SwUart_GetFrameTimes() hands out for the next byte. */
+static uint16_t FrameStart, FrameDone;
+static bool FrameFresh;
+
+static uint32_t Milliseconds;
+static LatencyProbe_Report_t Report;
+static unsigned Failures;
+
+uint32_t Timer_GetMilliseconds( void )
+{
+  return Milliseconds;
+}
+
+bool SwUart_GetFrameTimes( uint16_t* const StartEdge, uint16_t* const Done )
+{
+  *StartEdge = FrameStart;
+  *Done = FrameDone;
+  return FrameFresh;
+}
+
+void Endpoint_SelectEndpoint( const uint8_t Address )
+{
+}
+
+bool Endpoint_IsINReady( void )
+{
+  return INReady;
+}
+
+void Endpoint_ClearSETUP( void )
+{
+}
+
+void Endpoint_ClearOUT( void )
+{
+}
+
+uint8_t Endpoint_Write_Control_Stream_LE( const void* const Buffer, uint16_t Length )
+{
+  memcpy( &Report, Buffer, ( Length < sizeof(Report) ) ? Length : sizeof(Report) );
+  return 0;
+}
+
+/** Processes a byte received with the frame times \p Start and \p Done, picked up at \p PickedUp. */
+static void Byte( const uint8_t Data, const uint16_t Start, const uint16_t Done, const bool Fresh,
+                  const uint16_t PickedUp, const bool ReportChanged )
+{
+  FrameStart = Start;
+  FrameDone = Done;
+  FrameFresh = Fresh;
+  LatencyProbe_ByteProcessed( Data, PickedUp, ReportChanged );
+}
+
+/** Writes a keyboard report at \p Ticks. */
+static void Written( const uint16_t Ticks )
+{
+  TCNT1 = Ticks;
+  INReady = false;
+  LatencyProbe_ReportWritten( );
+}
+
+/** Runs the probe's task at \p Ticks, with the host having polled the endpoint or not. */
+static void Task( const uint16_t Ticks, const bool Fetched )
+{
+  TCNT1 = Ticks;
+  INReady = Fetched;
+  LatencyProbe_Task( );
+}
+
+/** Reads the completed records like the host does. */
+static void ReadReport( void )
+{
+  memset( &Report, 0xAA, sizeof(Report) );
+  USB_ControlRequest = (USB_Request_Header_t){
+    .bmRequestType = REQDIR_DEVICETOHOST | REQTYPE_CLASS | REQREC_INTERFACE,
+    .bRequest = HID_REQ_GetReport,
+    .wValue = ( ( HID_REPORT_ITEM_Feature + 1 ) << 8 ) | LATENCY_PROBE_REPORTID,
+    .wIndex = INTERFACE_ID_Vendor,
+    .wLength = sizeof(Report),
+  };
+  VendorInterface_ProcessControlRequest( );
+}
+
+/** Compares record \p Index of the last report with the expected flags and timestamps. */
+static void CheckRecord( const char* const Name, const uint8_t Index, const uint8_t Data, const uint8_t Flags,
+                         const uint16_t StartEdge, const uint16_t Decoded, const uint16_t PickedUp,
+                         const uint16_t WrittenTicks, const uint16_t Fetched )
+{
+  const LatencyProbe_Record_t* Record = &Report.Records[Index];
+
+  if( ( Report.ReportID != LATENCY_PROBE_REPORTID ) || ( Index >= Report.Count ) ) {
+    printf( "FAIL %s: report %02X has %u records\n", Name, Report.ReportID, Report.Count );
+    Failures++;
+    return;
+  }
+
+  /* the frame times of a stale byte are not looked at */
+  if( ( Record->Data != Data ) || ( Record->Flags != Flags ) || ( Record->PickedUp != PickedUp ) ||
+      ( Record->Written != WrittenTicks ) || ( Record->Fetched != Fetched ) ||
+      ( Record->Milliseconds != Milliseconds ) ||
+      ( !( Flags & LATENCY_PROBE_FLAG_Stale ) && ( ( Record->StartEdge != StartEdge ) || ( Record->Decoded != Decoded ) ) ) ) {
+    printf( "FAIL %s: data %02X flags %02X times %u %u %u %u %u ms %lu, expected %02X %02X %u %u %u %u %u ms %lu\n",
+            Name, Record->Data, Record->Flags, Record->StartEdge, Record->Decoded, Record->PickedUp, Record->Written,
+            Record->Fetched, (unsigned long)Record->Milliseconds, Data, Flags, StartEdge, Decoded, PickedUp,
+            WrittenTicks, Fetched, (unsigned long)Milliseconds );
+    Failures++;
+  }
+}
+
+/** Checks the number of records in the last report. */
+static void CheckCount( const char* const Name, const uint8_t Count, const uint8_t Lost )
+{
+  if( ( Report.Count != Count ) || ( Report.Lost != Lost ) ) {
+    printf( "FAIL %s: %u records %u lost, expected %u records %u lost\n", Name, Report.Count, Report.Lost, Count,
+            Lost );
+    Failures++;
+  }
+}
+
+/** A byte's record completes once the host has polled its report, with all its timestamps. */
+static void Test_Fresh( void )
+{
+  Milliseconds = 1000;
+  Byte( 0x12, 10, 50, true, 100, true );
+  Written( 200 );
+  Task( 300, false );
+  ReadReport( );
+  CheckCount( "fresh, before the poll", 0, 0 );
+
+  Task( 400, true );
+  ReadReport( );
+  CheckCount( "fresh", 1, 0 );
+  CheckRecord( "fresh", 0, 0x12, 0, 10, 50, 100, 200, 400 );
+}
+
+/** A byte that sat in the buffer is flagged stale, and is still stamped with its report write. */
+static void Test_Stale( void )
+{
+  Milliseconds = 2000;
+  Byte( 0x34, 0, 0, false, 1100, true );
+  Written( 1200 );
+  Task( 1300, true );
+  ReadReport( );
+  CheckCount( "stale", 1, 0 );
+  CheckRecord( "stale", 0, 0x34, LATENCY_PROBE_FLAG_Stale, 0, 0, 1100, 1200, 1300 );
+}
+
+/** Bytes processed after a report was written wait for the next one, timestamps may wrap. */
+static void Test_NextReport( void )
+{
+  Milliseconds = 3000;
+  Byte( 0x56, 65000, 65100, true, 65200, false );
+  Written( 65300 );
+  Byte( 0x57, 65400, 65500, true, 100, true );
+  Task( 200, true );
+  ReadReport( );
+  CheckCount( "next report, first", 1, 0 );
+  CheckRecord( "next report, first", 0, 0x56, LATENCY_PROBE_FLAG_Unchanged, 65000, 65100, 65200, 65300, 200 );
+
+  Written( 300 );
+  Task( 400, true );
+  ReadReport( );
+  CheckCount( "next report, second", 1, 0 );
+  CheckRecord( "next report, second", 0, 0x57, 0, 65400, 65500, 100, 300, 400 );
+}
+
+/** Bytes beyond the records in flight are counted as lost. */
+static void Test_Lost( void )
+{
+  Milliseconds = 4000;
+  for( uint8_t i = 0; i < 6; i++ )
+    Byte( 0x60 + i, 10 * i, 10 * i + 5, true, 100 + i, true );
+  Written( 200 );
+  Task( 300, true );
+  ReadReport( );
+  CheckCount( "lost", 4, 2 );
+  for( uint8_t i = 0; i < 4; i++ )
+    CheckRecord( "lost", i, 0x60 + i, 0, 10 * i, 10 * i + 5, 100 + i, 200, 300 );
+}
+
+int main( void )
+{
+  Test_Fresh( );
+  Test_Stale( );
+  Test_NextReport( );
+  Test_Lost( );
+
+  if( Failures ) {
+    printf( "%u failures\n", Failures );
+    return 1;
+  }
+
+  printf( "latency probe: all tests passed\n" );
+  return 0;
+}
@@ -0,0 +1,259 @@
+/** \file
+ *
+ *  Host test of the software UART's decoder (../src/SoftwareUart.c). The line is simulated as a
+ *  list of edges with their Timer1 counts. Each edge is handed to the INT0 routine with the timer
+ *  read INTERRUPT_EXEC_CYCL late, as on the device, and the compare B routine runs whenever the
+ *  timer passes OCR1B with its interrupt enabled. Timestamps start just below the 16-bit wrap.
+ *
+ *    make check
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* the decoder's routines are static, the test is built as part of the module */
+#include "SoftwareUart.c"
+
+uint8_t PIND, PORTD, DDRD, EIMSK, EIFR, EICRA, TIMSK1, TIFR1, TCCR1B;
+uint16_t TCNT1, OCR1B;
+volatile bool Timer_SlowClock;
+
+#define LINE_MAX_EDGES  4096
+#define RECEIVED_MAX    1024
+
+/** Bit period at BAUDRATE in Timer1 ticks, without the rounding of BAUD_TICKS(). */
+#define BIT_TICKS  ( (double)TIMER_TICKS_PER_SECOND / BAUDRATE )
+
+/** The RX line as the keyboard drives it. */
+static struct
+{
+  bool Inverted;                  //!< Idles low, the Palm keyboard's levels.
+  bool Level;                     //!< Current logical level, 1 is mark/idle.
+  double Time;                    //!< Current time in Timer1 ticks since the start.
+  uint16_t Count;
+  double EdgeTime[LINE_MAX_EDGES];
+  bool EdgeLevel[LINE_MAX_EDGES]; //!< Logical level after the edge.
+} Line;
+
+static uint8_t Received[RECEIVED_MAX];
+static uint16_t ReceivedCount;
+static unsigned Failures;
+
+/** Starts an idle line, with the receiver set to the same polarity and \p BitTicks. */
+static void Line_Reset( const bool Inverted, const uint16_t BitTicks )
+{
+  memset( &Line, 0, sizeof(Line) );
+  Line.Inverted = Inverted;
+  Line.Level = 1;
+  Line.Time = 0;
+
+  SwUart_Init( );
+  SwUart_RestoreCalibration( BitTicks, Inverted );
+  PIND = Inverted ? 0 : ( 1 << RX_PIN );
+  ReceivedCount = 0;
+}
+
+/** Holds \p Level on the line for \p Ticks. */
+static void Line_Hold( const bool Level, const double Ticks )
+{
+  if( Level != Line.Level ) {
+    if( Line.Count == LINE_MAX_EDGES ) {
+      fprintf( stderr, "too many edges\n" );
+      exit( 2 );
+    }
+    Line.EdgeTime[Line.Count] = Line.Time;
+    Line.EdgeLevel[Line.Count] = Level;
+    Line.Count++;
+    Line.Level = Level;
+  }
+  Line.Time += Ticks;
+}
+
+/** Sends one frame of 8N1 with the bit period \p BitTicks, \p StopBit false for a missing stop bit. */
+static void Line_Frame( const uint8_t Byte, const double BitTicks, const bool StopBit )
+{
+  Line_Hold( 0, BitTicks );
+  for( uint8_t i = 0; i < 8; i++ )
+    Line_Hold( ( Byte >> i ) & 1, BitTicks );
+  Line_Hold( StopBit, BitTicks );
+}
+
+/** Sets the pin as the line's level appears on it and the timer as INT0 reads it. */
+static void Line_Edge( const uint16_t Index, const uint16_t Start )
+{
+  bool PinHigh = ( Line.EdgeLevel[Index] != Line.Inverted );
+  uint16_t Timestamp = Start + (uint16_t)lround( Line.EdgeTime[Index] );
+
+  PIND = PinHigh ? ( 1 << RX_PIN ) : 0;
+  TCNT1 = Timestamp + INTERRUPT_EXEC_TICKS( 1 );
+}
+
+/** Runs the frame timeout if it is due before \p Timestamp. */
+static void Line_Timeout( const uint16_t Timestamp )
+{
+  if( ( TIMSK1 & ( 1 << OCIE1B ) ) && ( (int16_t)( Timestamp - OCR1B ) >= 0 ) ) {
+    TCNT1 = OCR1B;
+    TIMER1_COMPB_vect( );
+  }
+}
+
+/** Fetches the bytes decoded so far. */
+static void Line_Collect( void )
+{
+  int16_t Byte;
+
+  while( ( Byte = SwUart_ReceiveByte( ) ) >= 0 ) {
+    if( ReceivedCount < RECEIVED_MAX )
+      Received[ReceivedCount] = Byte;
+    ReceivedCount++;
+  }
+}
+
+/** Feeds the recorded edges to the receiver, followed by two idle bytes. */
+static void Line_Run( void )
+{
+  const uint16_t Start = 0xFF00;
+
+  for( uint16_t i = 0; i < Line.Count; i++ ) {
+    uint16_t Timestamp = Start + (uint16_t)lround( Line.EdgeTime[i] );
+    Line_Timeout( Timestamp );
+    Line_Edge( i, Start );
+    INT0_vect( );
+    Line_Collect( );
+  }
+
+  Line_Timeout( Start + (uint16_t)lround( Line.Time + 20 * BIT_TICKS ) );
+  Line_Collect( );
+}
+
+/** Compares the received bytes with \p Expected. */
+static void Check( const char* const Name, const uint8_t* const Expected, const uint16_t Count )
+{
+  if( ( ReceivedCount == Count ) && ( memcmp( Received, Expected, Count ) == 0 ) )
+    return;
+
+  printf( "FAIL %s: expected %u bytes, received %u:", Name, Count, ReceivedCount );
+  for( uint16_t i = 0; ( i < ReceivedCount ) && ( i < RECEIVED_MAX ) && ( i < 16 ); i++ )
+    printf( " %02X", Received[i] );
+  printf( "\n" );
+  Failures++;
+}
+
+/** All byte values back to back, at the nominal rate off by \p ErrorPermille, in both polarities. */
+static void Test_AllBytes( const int ErrorPermille )
+{
+  uint8_t Expected[256];
+
+  for( uint16_t i = 0; i < 256; i++ )
+    Expected[i] = i;
+
+  for( uint8_t Inverted = 0; Inverted < 2; Inverted++ ) {
+    char Name[64];
+
+    snprintf( Name, sizeof(Name), "all bytes, %+d permille, %s", ErrorPermille, Inverted ? "inverted" : "normal" );
+    Line_Reset( Inverted, BAUD_TICKS(BAUDRATE) );
+    for( uint16_t i = 0; i < 256; i++ )
+      Line_Frame( i, BIT_TICKS * 1000 / ( 1000 + ErrorPermille ), true );
+    Line_Run( );
+    Check( Name, Expected, 256 );
+  }
+}
+
+/** Pulses to the space level shorter than half a bit are not start bits. */
+static void Test_Glitches( void )
+{
+  static const uint8_t Expected[] = { 0x55, 0x00 };
+
+  for( uint8_t Inverted = 0; Inverted < 2; Inverted++ ) {
+    Line_Reset( Inverted, BAUD_TICKS(BAUDRATE) );
+    for( double Width = 1; Width < BIT_TICKS / 2 - 1; Width += BIT_TICKS / 16 ) {
+      Line_Hold( 0, Width );
+      Line_Hold( 1, 2 * BIT_TICKS );
+    }
+    Line_Frame( 0x55, BIT_TICKS, true );
+    Line_Hold( 0, BIT_TICKS / 3 );
+    Line_Hold( 1, BIT_TICKS );
+    Line_Frame( 0x00, BIT_TICKS, true );
+    Line_Run( );
+    Check( Inverted ? "glitches, inverted" : "glitches, normal", Expected, sizeof(Expected) );
+  }
+}
+
+/** A frame whose stop bit is space is dropped, the receiver picks up the next start bit after it. */
+static void Test_MissingStopBit( void )
+{
+  static const uint8_t Expected[] = { 0x41, 0x42 };
+
+  for( uint8_t Inverted = 0; Inverted < 2; Inverted++ ) {
+    Line_Reset( Inverted, BAUD_TICKS(BAUDRATE) );
+    Line_Frame( 0x41, BIT_TICKS, true );
+    Line_Frame( 0x30, BIT_TICKS, false );
+    Line_Hold( 0, 10 * BIT_TICKS );     // no edge before the timeout, the line stays in a break
+    Line_Hold( 1, 3 * BIT_TICKS );
+    Line_Frame( 0x42, BIT_TICKS, true );
+    Line_Run( );
+    Check( Inverted ? "missing stop bit, inverted" : "missing stop bit, normal", Expected, sizeof(Expected) );
+  }
+}
+
+/** The keyboard's id bytes 0xFA 0xFD are recorded, measured and then decoded from the recording. */
+static void Test_Calibration( const uint32_t Baud, const int ErrorPermille )
+{
+  static const uint8_t Expected[] = { 0xFA, 0xFD };
+  const double BitTicks = (double)TIMER_TICKS_PER_SECOND / Baud * 1000 / ( 1000 + ErrorPermille );
+
+  for( uint8_t Inverted = 0; Inverted < 2; Inverted++ ) {
+    char Name[64];
+
+    snprintf( Name, sizeof(Name), "calibration, %lu baud %+d permille, %s", (unsigned long)Baud, ErrorPermille,
+              Inverted ? "inverted" : "normal" );
+
+    /* the receiver starts out with the other polarity and rate */
+    Line_Reset( Inverted, BAUD_TICKS(BAUDRATE) );
+    SwUart_RestoreCalibration( BAUD_TICKS(2400), !Inverted );
+    SwUart_StartCalibration( );
+
+    Line_Hold( 1, BitTicks );
+    Line_Frame( 0xFA, BitTicks, true );
+    Line_Frame( 0xFD, BitTicks, true );
+    Line_Run( );
+
+    if( !SwUart_FinishCalibration( ) ) {
+      printf( "FAIL %s: too few edges\n", Name );
+      Failures++;
+      continue;
+    }
+    Line_Collect( );
+    Check( Name, Expected, sizeof(Expected) );
+
+    if( ( SwUart_GetBitTicks( ) != BAUD_TICKS(Baud) ) || ( SwUart_IsInverted( ) != Inverted ) ) {
+      printf( "FAIL %s: measured %u ticks %s, expected %u ticks\n", Name, SwUart_GetBitTicks( ),
+              SwUart_IsInverted( ) ? "inverted" : "normal", (unsigned)BAUD_TICKS(Baud) );
+      Failures++;
+    }
+  }
+}
+
+int main( void )
+{
+  Test_AllBytes( 0 );
+  Test_AllBytes( 20 );
+  Test_AllBytes( -20 );
+  Test_Glitches( );
+  Test_MissingStopBit( );
+  Test_Calibration( 9600, 0 );
+  Test_Calibration( 9600, 20 );
+  Test_Calibration( 9600, -20 );
+  Test_Calibration( 4800, 0 );
+  Test_Calibration( 19200, 0 );
+
+  if( Failures ) {
+    printf( "%u failures\n", Failures );
+    return 1;
+  }
+
+  printf( "software uart: all tests passed\n" );
+  return 0;
+}
@@ -0,0 +1,9 @@
+/* The tests are single threaded, an atomic block is an ordinary block. */
+
+#ifndef _TEST_UTIL_ATOMIC_H_
+#define _TEST_UTIL_ATOMIC_H_
+
+#define ATOMIC_RESTORESTATE 0
+#define ATOMIC_BLOCK(type) for (int AtomicOnce = 1; AtomicOnce; AtomicOnce = 0)
+
+#endif
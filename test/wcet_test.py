@@ -0,0 +1,168 @@
+#!/usr/bin/env python3
+"""Regression test of the worst-case cycle analyser (../tools/avr_wcet.py).
+
+The functions below are written as small assembly listings and turned into the text avr-objdump -d
+prints, so each expected cycle count can be followed by hand from the AVR instruction set manual.
+
+  make check
+"""
+
+import os
+import subprocess
+import sys
+import unittest
+
+TOOLS = os.path.join(os.path.dirname(os.path.abspath(__file__)), '..', 'tools')
+sys.path.insert(0, TOOLS)
+
+import avr_wcet  # noqa: E402
+
+# Instructions of two words, everything else in the listings is one word
+TWO_WORDS = {'call', 'jmp', 'lds', 'sts'}
+
+
+def disassemble(functions):
+    """avr-objdump -d style text of {name: (address, [line])}. A line is "label:" or an instruction,
+    whose branch or call target may be given as "@label" or "@function"."""
+    labels, listing = {}, []
+    for name, (address, lines) in functions.items():
+        labels[name] = address
+        for line in lines:
+            if line.endswith(':'):
+                labels[line[:-1]] = address
+                continue
+            mnemonic = line.split()[0]
+            listing.append((name, address, line))
+            address += 4 if mnemonic in TWO_WORDS else 2
+
+    text, current = [], None
+    for name, address, line in listing:
+        if name != current:
+            text.append('')
+            text.append('%08x <%s>:' % (functions[name][0], name))
+            current = name
+        mnemonic, _, operands = line.partition(' ')
+        if '@' in operands:
+            target = labels[operands.split('@')[1]]
+            operands = '.%+d \t; 0x%x' % (target - address - 2, target)
+        size = 4 if mnemonic in TWO_WORDS else 2
+        text.append('%8x:\t%s\t%s\t%s' % (address, '00 ' * size, mnemonic, operands))
+    return [line + '\n' for line in text]
+
+
+LEAF = ['cpi r24, 0x01',      # 1
+        'breq @else',         # 1, 2 taken
+        'ldi r24, 0x02',      # 1
+        'rjmp @merge',        # 2
+        'else:',
+        'lds r24, 0x0100',    # 2
+        'nop',                # 1
+        'merge:',
+        'ret']                # 4
+
+CODE = {
+    # both sides of the branch meet again: 1 + 2 + 2 + 1 + 4 taken, 1 + 1 + 1 + 2 + 4 not taken
+    'leaf': (0x100, LEAF),
+    # 2 + (4 + 10) + 2 + 4
+    'middle': (0x200, ['push r16', 'call @leaf', 'pop r16', 'ret']),
+    # (3 + 22) + 4
+    'top': (0x280, ['rcall @middle', 'ret']),
+    # 1 + 4 * (1 + 2) + (1 + 1) + 4
+    'loop': (0x300, ['ldi r24, 0x05', 'again:', 'dec r24', 'brne @again', 'ret']),
+    # a skip over a two word instruction lands behind it: 1 + 2 + 4 either way
+    'skip': (0x380, ['sbrs r24, 0', 'lds r24, 0x0100', 'ret']),
+    # lsl rol lpm lpm mov ijmp: 1 + 1 + 3 + 3 + 1 + 2
+    '__tablejump2__': (0x400, ['lsl r30', 'rol r31', 'lpm r0, Z+', 'lpm r31, Z', 'mov r30, r0', 'ijmp']),
+    # 1 + 1 + (4 + 11) + slowest case 2 + 1 + 4
+    'switch': (0x480, ['cpi r24, 0x02', 'brcc @default', 'call @__tablejump2__',
+                       'ldi r24, 0x01', 'ret',
+                       'lds r24, 0x0100', 'nop', 'ret',
+                       'default:', 'ret']),
+    # 2 + 2 + 2 + 2 + 4, TCNT1 read after 4
+    '__vector_1': (0x500, ['push r24', 'lds r24, 0x0084', 'sts 0x0100, r24', 'pop r24', 'reti']),
+    # 2 + (4 + 29) + 2 + 4
+    '__vector_17': (0x580, ['push r24', 'call @top', 'pop r24', 'reti']),
+    'unbounded': (0x600, ['again2:', 'rjmp @again2']),
+    'recursive': (0x680, ['rcall @recursive', 'ret']),
+    'indirect': (0x700, ['icall', 'ret']),
+}
+
+VECTOR_EXTRA = avr_wcet.IRQ_COMPLETION_CYCLES + avr_wcet.IRQ_ENTRY_CYCLES
+
+
+def analyzer(loop_bounds=None, icalls=None):
+    functions, names = avr_wcet.parse_objdump(disassemble(CODE))
+    return avr_wcet.Analyzer(functions, names, loop_bounds or {}, icalls or {})
+
+
+def run(*arguments):
+    """Runs the tool on the listings, returns its exit status and output."""
+    result = subprocess.run([sys.executable, os.path.join(TOOLS, 'avr_wcet.py')] + list(arguments) + ['-'],
+                            input=''.join(disassemble(CODE)), capture_output=True, text=True)
+    return result.returncode, result.stdout
+
+
+class Functions(unittest.TestCase):
+    def test_branch_merge(self):
+        self.assertEqual(analyzer().analyze('leaf'), 10)
+
+    def test_call_depth(self):
+        self.assertEqual(analyzer().analyze('middle'), 22)
+        self.assertEqual(analyzer().analyze('top'), 29)
+
+    def test_loop_bound(self):
+        self.assertEqual(analyzer({'loop': 5}).analyze('loop'), 19)
+        self.assertEqual(analyzer({'loop': 1}).analyze('loop'), 7)
+
+    def test_skip_two_words(self):
+        self.assertEqual(analyzer().analyze('skip'), 7)
+
+    def test_jump_table(self):
+        self.assertEqual(analyzer().analyze('switch'), 1 + 1 + 4 + 11 + 7)
+
+    def test_tcnt1_read(self):
+        self.assertEqual(analyzer().first_read('__vector_1', avr_wcet.TCNT1_ADDRESS), 4)
+        self.assertIsNone(analyzer().first_read('__vector_17', avr_wcet.TCNT1_ADDRESS))
+
+    def test_unresolved(self):
+        for name, message in (('unbounded', 'give a bound'), ('recursive', 'recursion'), ('indirect', '--icall')):
+            with self.assertRaises(avr_wcet.AnalysisError) as context:
+                analyzer().analyze(name)
+            self.assertIn(message, str(context.exception))
+        self.assertEqual(analyzer(icalls={'indirect': ['leaf', 'middle']}).analyze('indirect'), 3 + 22 + 4)
+
+
+class Budgets(unittest.TestCase):
+    def test_vector_within_budget(self):
+        status, output = run('--budget', '__vector_1=%d' % (12 + VECTOR_EXTRA),
+                             '--budget', '__vector_17=%d' % (41 + VECTOR_EXTRA))
+        self.assertEqual(status, 0, output)
+        self.assertNotIn('OVER BUDGET', output)
+
+    def test_vector_over_budget(self):
+        # one cycle short only because of the interrupted instruction
+        status, output = run('--budget', '__vector_1=%d' % (12 + VECTOR_EXTRA - 1))
+        self.assertEqual(status, 1)
+        self.assertIn('OVER BUDGET', output)
+
+    def test_function_over_budget(self):
+        status, output = run('--budget', 'top=28')
+        self.assertEqual(status, 1)
+        self.assertIn('OVER BUDGET', output)
+
+    def test_tcnt1_cycles(self):
+        expected = 4 + avr_wcet.IRQ_ENTRY_CYCLES
+        status, output = run('--budget', '__vector_1=1000', '--tcnt1-cycles', '__vector_1=%d' % expected)
+        self.assertEqual(status, 0, output)
+        status, output = run('--budget', '__vector_1=1000', '--tcnt1-cycles', '__vector_1=%d' % (expected + 1))
+        self.assertEqual(status, 1)
+        self.assertIn('CONFIGURED AS %d' % (expected + 1), output)
+
+    def test_analysis_error(self):
+        status, output = run('--budget', 'unbounded=1000')
+        self.assertEqual(status, 1)
+        self.assertIn('error:', output)
+
+
+if __name__ == '__main__':
+    unittest.main()
@@ -0,0 +1,433 @@
+#!/usr/bin/env python3
+"""Static worst-case cycle count of AVR functions, from the disassembly of the linked ELF.
+
+Reads the output of `avr-objdump -d` and builds the control flow graph of each requested
+function, including everything it calls. The worst case is the longest path through that
+graph, with every conditional branch taken if that is slower, every skip instruction
+skipping, and every loop running its configured number of iterations. The prologue and
+epilogue are part of the function body, so they are counted like any other instruction.
+Interrupt vectors (__vector_N) additionally get the interrupt response, the jump in the vector
+table and the instruction the interrupt arrived in, which completes before the response starts.
+Time the interrupt is held off with interrupts disabled, by another interrupt routine or an
+atomic block, is not counted.
+
+Cycle counts are those of the AVRe+ core with a 16-bit program counter (ATmega32U4),
+see the AVR instruction set manual.
+
+Loops and indirect calls cannot be resolved from the code alone:
+  --loop-bound FUNC=N    every loop in FUNC runs at most N times (nested loops multiply)
+  --icall FUNC=T1,T2     icall/eicall in FUNC may call T1 or T2
+Switch jump tables (ijmp, or a jump through __tablejump2__) are assumed to reach any
+block of the function that has no other predecessor.
+
+  --budget FUNC=CYCLES   exit with an error if FUNC may take longer than CYCLES
+  --tcnt1-cycles VECTOR=CYCLES
+                         exit with an error unless the interrupt reads TCNT1 after exactly CYCLES,
+                         counted from the event, i.e. the value the firmware compensates. The
+                         interrupted instruction adds up to IRQ_COMPLETION_CYCLES of jitter to
+                         that, which cannot be compensated and is left out
+
+Example:
+  avr-objdump -d Keyboard.elf | avr_wcet.py --f-cpu 16000000 --budget __vector_1=833 -
+"""
+
+import argparse
+import re
+import sys
+
+# Interrupt response (conservatively five cycles) plus the jmp in the vector table
+IRQ_ENTRY_CYCLES = 5 + 3
+
+# An interrupt waits for the instruction it arrives in to complete, up to the 4 cycles of call,
+# ret or reti. Part of the worst case, not of the fixed delay until TCNT1 is read.
+IRQ_COMPLETION_CYCLES = 4
+
+# Timer1 count register, its first read in an interrupt is the edge timestamp of the uart
+TCNT1_ADDRESS = 0x84
+
+CYCLES = {
+    'adiw': 2, 'sbiw': 2,
+    'mul': 2, 'muls': 2, 'mulsu': 2, 'fmul': 2, 'fmuls': 2, 'fmulsu': 2,
+    'ld': 2, 'ldd': 2, 'lds': 2, 'st': 2, 'std': 2, 'sts': 2,
+    'push': 2, 'pop': 2,
+    'sbi': 2, 'cbi': 2,
+    'lpm': 3, 'elpm': 3,
+    'rjmp': 2, 'jmp': 3, 'ijmp': 2, 'eijmp': 2,
+    'rcall': 3, 'call': 4, 'icall': 3, 'eicall': 4,
+    'ret': 4, 'reti': 4,
+}
+
+BRANCHES = {'breq', 'brne', 'brcs', 'brcc', 'brsh', 'brlo', 'brmi', 'brpl', 'brge', 'brlt',
+            'brhs', 'brhc', 'brts', 'brtc', 'brvs', 'brvc', 'brie', 'brid', 'brbs', 'brbc'}
+SKIPS = {'cpse', 'sbrc', 'sbrs', 'sbic', 'sbis'}
+
+LINE_RE = re.compile(r'^\s*([0-9a-f]+):\t((?:[0-9a-f]{2} )+)\s*\t(\S+)\s*(.*)$')
+SYMBOL_RE = re.compile(r'^([0-9a-f]+) <([^>]+)>:$')
+TARGET_RE = re.compile(r';\s*0x([0-9a-f]+)')
+
+
+class AnalysisError(Exception):
+    pass
+
+
+class Instruction:
+    def __init__(self, address, size, mnemonic, operands):
+        self.address = address
+        self.size = size
+        self.mnemonic = mnemonic
+        self.operands = operands
+
+    def target(self):
+        match = TARGET_RE.search(self.operands)
+        if match:
+            return int(match.group(1), 16)
+        match = re.match(r'0x([0-9a-f]+)', self.operands)
+        if match:
+            return int(match.group(1), 16)
+        raise AnalysisError('no target address in "%s %s" at 0x%x' % (self.mnemonic, self.operands, self.address))
+
+    def cycles(self):
+        return CYCLES.get(self.mnemonic, 1)
+
+    def reads(self, address):
+        if self.mnemonic != 'lds':
+            return False
+        return int(self.operands.split(',')[1].split(';')[0].strip(), 0) == address
+
+
+def parse_objdump(lines):
+    """Returns {name: [Instruction]} and {address: name} for all symbols with code."""
+    functions = {}
+    names = {}
+    current = None
+    for line in lines:
+        line = line.rstrip('\n')
+        match = SYMBOL_RE.match(line)
+        if match:
+            current = match.group(2)
+            names[int(match.group(1), 16)] = current
+            functions[current] = []
+            continue
+        match = LINE_RE.match(line)
+        if match and current is not None:
+            size = len(match.group(2).split())
+            functions[current].append(Instruction(int(match.group(1), 16), size,
+                                                  match.group(3), match.group(4)))
+    return functions, names
+
+
+class Analyzer:
+    def __init__(self, functions, names, loop_bounds, icall_targets):
+        self.functions = functions
+        self.names = names
+        self.loop_bounds = loop_bounds
+        self.icall_targets = icall_targets
+        self.wcet = {}
+        self.active = []
+
+    def callee(self, address):
+        if address not in self.names:
+            raise AnalysisError('call to 0x%x, which is not the start of a function' % address)
+        return self.names[address]
+
+    def is_dispatch(self, name):
+        """True for helpers like __tablejump2__ that end in an indirect jump instead of a return."""
+        code = self.functions.get(name, [])
+        return bool(code) and code[-1].mnemonic in ('ijmp', 'eijmp')
+
+    def dispatch_cycles(self, name):
+        return sum(i.cycles() for i in self.functions[name])
+
+    def analyze(self, name):
+        """Worst-case cycles of one call of the function, including its return."""
+        if name in self.wcet:
+            return self.wcet[name]
+        if name in self.active:
+            raise AnalysisError('recursion: %s' % ' -> '.join(self.active + [name]))
+        if name not in self.functions or not self.functions[name]:
+            raise AnalysisError('no code for %s' % name)
+
+        self.active.append(name)
+        graph = FunctionGraph(self, name)
+        self.wcet[name] = graph.longest_path()
+        self.active.pop()
+        return self.wcet[name]
+
+    def first_read(self, name, address):
+        """Worst-case cycles from the start of the function until the first read of an I/O address."""
+        graph = FunctionGraph(self, name)
+        return graph.longest_path_to(lambda i: i.reads(address))
+
+
+class FunctionGraph:
+    EXIT = -1
+
+    def __init__(self, analyzer, name):
+        self.analyzer = analyzer
+        self.name = name
+        self.code = analyzer.functions[name]
+        self.index = {i.address: n for n, i in enumerate(self.code)}
+        self.cost = [0] * len(self.code)
+        self.edges = [[] for _ in self.code]   # (successor, extra cycles)
+        self.dispatches = []
+        self.build()
+        self.resolve_dispatches()
+        self.extra = [0] * len(self.code)
+        self.back_edges = self.find_back_edges()
+        self.bound_loops()
+
+    def inside(self, address):
+        return address in self.index
+
+    def build(self):
+        for n, instr in enumerate(self.code):
+            mnemonic = instr.mnemonic
+            self.cost[n] = instr.cycles()
+            following = n + 1 if n + 1 < len(self.code) else None
+
+            if mnemonic in BRANCHES:
+                self.fallthrough(n, following)
+                self.jump(n, instr.target(), 1)
+            elif mnemonic in SKIPS:
+                self.fallthrough(n, following)
+                if following is None:
+                    raise AnalysisError('%s: skip past the end at 0x%x' % (self.name, instr.address))
+                skipped = self.code[following]
+                self.edges[n].append((following + 1, 2 if skipped.size == 4 else 1))
+            elif mnemonic in ('rjmp', 'jmp'):
+                target = instr.target()
+                if self.inside(target):
+                    self.jump(n, target, 0)
+                else:
+                    # tail call, the callee returns for us
+                    callee = self.analyzer.callee(target)
+                    if self.analyzer.is_dispatch(callee):
+                        self.cost[n] += self.analyzer.dispatch_cycles(callee)
+                        self.dispatch(n)
+                    else:
+                        self.cost[n] += self.analyzer.analyze(callee)
+                        self.edges[n].append((self.EXIT, 0))
+            elif mnemonic in ('rcall', 'call'):
+                callee = self.analyzer.callee(instr.target())
+                if self.analyzer.is_dispatch(callee):
+                    self.cost[n] += self.analyzer.dispatch_cycles(callee)
+                    self.dispatch(n)
+                else:
+                    self.cost[n] += self.analyzer.analyze(callee)
+                    self.fallthrough(n, following)
+            elif mnemonic in ('icall', 'eicall'):
+                targets = self.analyzer.icall_targets.get(self.name)
+                if not targets:
+                    raise AnalysisError('%s: indirect call at 0x%x, give its targets with --icall %s=...'
+                                        % (self.name, instr.address, self.name))
+                self.cost[n] += max(self.analyzer.analyze(t) for t in targets)
+                self.fallthrough(n, following)
+            elif mnemonic in ('ijmp', 'eijmp'):
+                self.dispatch(n)
+            elif mnemonic in ('ret', 'reti'):
+                self.edges[n].append((self.EXIT, 0))
+            else:
+                self.fallthrough(n, following)
+
+    def fallthrough(self, n, following):
+        if following is None:
+            raise AnalysisError('%s: runs past its end at 0x%x' % (self.name, self.code[n].address))
+        self.edges[n].append((following, 0))
+
+    def jump(self, n, target, extra):
+        if not self.inside(target):
+            raise AnalysisError('%s: branch at 0x%x leaves the function' % (self.name, self.code[n].address))
+        self.edges[n].append((self.index[target], extra))
+
+    def dispatch(self, n):
+        """Jump table, the targets are resolved in build() once all other edges are known."""
+        self.dispatches.append(n)
+
+    def resolve_dispatches(self):
+        """A jump table may continue at any instruction that is not reached otherwise."""
+        reached = {0}
+        for edges in self.edges:
+            reached.update(s for s, _ in edges if s != self.EXIT)
+        targets = [n for n in range(len(self.code)) if n not in reached]
+        for n in self.dispatches:
+            if not targets:
+                raise AnalysisError('%s: cannot find the targets of the jump table at 0x%x'
+                                    % (self.name, self.code[n].address))
+            self.edges[n].extend((t, 0) for t in targets)
+
+    def find_back_edges(self):
+        back = set()
+        state = [0] * len(self.code)     # 0 new, 1 on stack, 2 done
+        stack = [(0, iter(self.edges[0]))]
+        state[0] = 1
+        while stack:
+            node, successors = stack[-1]
+            for succ, _ in successors:
+                if succ == self.EXIT:
+                    continue
+                if state[succ] == 1:
+                    back.add((node, succ))
+                elif state[succ] == 0:
+                    state[succ] = 1
+                    stack.append((succ, iter(self.edges[succ])))
+                    break
+            else:
+                state[node] = 2
+                stack.pop()
+        return back
+
+    def forward(self, n):
+        return [(s, e) for s, e in self.edges[n] if s == self.EXIT or (n, s) not in self.back_edges]
+
+    def bound_loops(self):
+        if not self.back_edges:
+            return
+        bound = self.analyzer.loop_bounds.get(self.name)
+        if bound is None:
+            latch, header = sorted(self.back_edges)[0]
+            raise AnalysisError('%s: loop from 0x%x back to 0x%x, give a bound with --loop-bound %s=N'
+                                % (self.name, self.code[latch].address, self.code[header].address, self.name))
+
+        predecessors = [[] for _ in self.code]
+        for n, edges in enumerate(self.edges):
+            for s, _ in edges:
+                if s != self.EXIT:
+                    predecessors[s].append(n)
+
+        loops = {}
+        for latch, header in self.back_edges:
+            body = loops.setdefault(header, {header})
+            work = [latch]
+            while work:
+                n = work.pop()
+                if n not in body:
+                    body.add(n)
+                    work.extend(predecessors[n])
+
+        # inner loops first, their iterations are part of every iteration of the outer loop
+        for header, body in sorted(loops.items(), key=lambda item: len(item[1])):
+            distance = self.distances(header, body)
+            iteration = 0
+            for latch, h in self.back_edges:
+                if h == header and latch in distance:
+                    extra = next(e for s, e in self.edges[latch] if s == header)
+                    iteration = max(iteration, distance[latch] + extra)
+            self.extra[header] += (bound - 1) * iteration
+
+    def node_cost(self, n):
+        return self.cost[n] + self.extra[n]
+
+    def topological(self, start, allowed=None):
+        order, seen = [], set()
+        stack = [(start, False)]
+        while stack:
+            n, expanded = stack.pop()
+            if expanded:
+                order.append(n)
+                continue
+            if n in seen:
+                continue
+            seen.add(n)
+            stack.append((n, True))
+            for s, _ in self.forward(n):
+                if s != self.EXIT and s not in seen and (allowed is None or s in allowed):
+                    stack.append((s, False))
+        order.reverse()
+        return order
+
+    def distances(self, start, allowed=None):
+        """Longest time from the start of `start` until the end of each reachable instruction."""
+        distance = {start: self.node_cost(start)}
+        for n in self.topological(start, allowed):
+            if n not in distance:
+                continue
+            for s, extra in self.forward(n):
+                if s == self.EXIT or (allowed is not None and s not in allowed):
+                    continue
+                d = distance[n] + extra + self.node_cost(s)
+                if d > distance.get(s, -1):
+                    distance[s] = d
+        return distance
+
+    def longest_path(self):
+        distance = self.distances(0)
+        exits = [distance[n] + extra for n in distance for s, extra in self.forward(n) if s == self.EXIT]
+        if not exits:
+            raise AnalysisError('%s: never returns' % self.name)
+        return max(exits)
+
+    def longest_path_to(self, predicate):
+        distance = self.distances(0)
+        hits = [n for n in distance if predicate(self.code[n])]
+        if not hits:
+            return None
+        return distance[min(hits)]
+
+
+def parse_assignments(values, convert):
+    result = {}
+    for value in values:
+        name, _, setting = value.partition('=')
+        if not setting:
+            raise SystemExit('expected NAME=VALUE, got "%s"' % value)
+        result[name] = convert(setting)
+    return result
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument('disassembly', help='output of avr-objdump -d, - for stdin')
+    parser.add_argument('--f-cpu', type=int, default=16000000, help='CPU clock in Hz, for the times in the report')
+    parser.add_argument('--budget', action='append', default=[], metavar='FUNC=CYCLES')
+    parser.add_argument('--loop-bound', action='append', default=[], metavar='FUNC=N')
+    parser.add_argument('--icall', action='append', default=[], metavar='FUNC=T1,T2')
+    parser.add_argument('--tcnt1-cycles', action='append', default=[], metavar='VECTOR=CYCLES')
+    parser.add_argument('functions', nargs='*', help='further functions to report without a budget')
+    args = parser.parse_intermixed_args()
+
+    stream = sys.stdin if args.disassembly == '-' else open(args.disassembly)
+    functions, names = parse_objdump(stream)
+
+    budgets = parse_assignments(args.budget, int)
+    tcnt1_cycles = parse_assignments(args.tcnt1_cycles, int)
+    analyzer = Analyzer(functions, names,
+                        parse_assignments(args.loop_bound, int),
+                        parse_assignments(args.icall, lambda v: v.split(',')))
+
+    failed = False
+    print('%-32s %8s %8s %8s' % ('function', 'cycles', 'us', 'budget'))
+    for name in list(budgets) + [f for f in args.functions if f not in budgets]:
+        try:
+            cycles = analyzer.analyze(name)
+        except AnalysisError as error:
+            print('%-32s error: %s' % (name, error))
+            failed = True
+            continue
+
+        if name.startswith('__vector_'):
+            cycles += IRQ_COMPLETION_CYCLES + IRQ_ENTRY_CYCLES
+        budget = budgets.get(name)
+        over = budget is not None and cycles > budget
+        failed |= over
+        print('%-32s %8d %8.1f %8s%s' % (name, cycles, cycles * 1e6 / args.f_cpu,
+                                         budget if budget is not None else '-',
+                                         '  OVER BUDGET' if over else ''))
+
+        if name.startswith('__vector_'):
+            timestamp = analyzer.first_read(name, TCNT1_ADDRESS)
+            expected = tcnt1_cycles.get(name)
+            if timestamp is not None:
+                timestamp += IRQ_ENTRY_CYCLES
+                wrong = expected is not None and timestamp != expected
+                failed |= wrong
+                print('%-32s %8d %8.1f  until TCNT1 is read%s' % ('', timestamp, timestamp * 1e6 / args.f_cpu,
+                                                                 '  CONFIGURED AS %d' % expected if wrong else ''))
+            elif expected is not None:
+                print('%-32s error: does not read TCNT1' % name)
+                failed = True
+
+    return 1 if failed else 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
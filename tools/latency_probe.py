@@ -0,0 +1,177 @@
+#!/usr/bin/env python3
+"""Measures the key press latency of a keyboard built with LATENCY_PROBE=1, stage by stage.
+
+The firmware timestamps every byte from the keyboard on its way to the USB endpoint and hands the
+records out as feature reports of the vendor specific HID interface (see src/LatencyProbe.h). This
+tool reads them while you type, pairs them with the events of the keyboard's evdev device and
+prints percentiles per stage:
+
+  uart      start bit edge until the byte is complete (includes the ~1ms frame at 9600 baud)
+  pickup    byte complete until the main loop takes it out of the receive buffer
+  report    pickup until the keyboard report is written to the endpoint
+  usb       report written until the host has polled it
+  host      host poll until the evdev event, relative to the fastest delivery seen
+
+The device and the host have no common clock, so "host" is measured against the lower envelope of
+(event time - device milliseconds), fitted over the run to follow the drift of the two crystals.
+It includes the granularity of the device's millisecond clock, and a constant part of the delivery
+(the fastest one) is not visible. Run it as root or with access to both device nodes:
+
+  latency_probe.py /dev/input/by-id/usb-...-event-kbd /dev/hidraw3 --duration 60
+"""
+
+import argparse
+import fcntl
+import os
+import select
+import struct
+import time
+
+TICKS_PER_SECOND = 2000000      # Timer1 runs at F_CPU / TIMER_PRESCALER, see src/Timer.h
+REPORTID = 0x04
+RECORDS_PER_REPORT = 6
+RECORD = struct.Struct('<BBIHHHHH')
+HEADER = struct.Struct('<BBB')
+REPORT_LENGTH = HEADER.size + RECORDS_PER_REPORT * RECORD.size
+FLAG_UNCHANGED = 1 << 0
+FLAG_STALE = 1 << 1
+
+INPUT_EVENT = struct.Struct('llHHi')
+EV_SYN, EV_KEY = 0x00, 0x01
+SYN_REPORT = 0
+CLOCK_MONOTONIC = 1
+CHUNK_MS = 5000
+
+
+def HIDIOCGFEATURE(length):
+    return (3 << 30) | (length << 16) | (ord('H') << 8) | 0x07
+
+
+def EVIOCSCLOCKID():
+    return (1 << 30) | (4 << 16) | (ord('E') << 8) | 0xa0
+
+
+def ticks_us(start, end, ticks_per_second):
+    return ((end - start) & 0xFFFF) * 1e6 / ticks_per_second
+
+
+def percentile(values, p):
+    values = sorted(values)
+    return values[min(len(values) - 1, int(round(p / 100.0 * (len(values) - 1))))]
+
+
+def read_records(device):
+    """Returns the lost count and the records of one feature report."""
+    buffer = bytearray(REPORT_LENGTH)
+    buffer[0] = REPORTID
+    fcntl.ioctl(device, HIDIOCGFEATURE(REPORT_LENGTH), buffer)
+    _, count, lost = HEADER.unpack_from(buffer)
+    return lost, [RECORD.unpack_from(buffer, HEADER.size + i * RECORD.size) for i in range(count)]
+
+
+def read_frames(evdev, frame):
+    """Collects key events into frames that end with SYN_REPORT, returns the completed ones."""
+    frames = []
+    try:
+        data = os.read(evdev, INPUT_EVENT.size * 64)
+    except BlockingIOError:
+        return frames
+    for offset in range(0, len(data) - INPUT_EVENT.size + 1, INPUT_EVENT.size):
+        sec, usec, kind, code, value = INPUT_EVENT.unpack_from(data, offset)
+        if kind == EV_KEY and value != 2:      # autorepeat is generated by the host
+            frame.append(code)
+        elif kind == EV_SYN and code == SYN_REPORT and frame:
+            frames.append(sec * 1000.0 + usec / 1000.0)
+            del frame[:]
+    return frames
+
+
+def fit_offset(pairs):
+    """Fits a line through the smallest host - device offset of each chunk of the run."""
+    chunks = {}
+    for device_ms, host_ms in pairs:
+        key = device_ms // CHUNK_MS
+        offset = host_ms - device_ms
+        if key not in chunks or offset < chunks[key][1]:
+            chunks[key] = (device_ms, offset)
+    points = sorted(chunks.values())
+    if len(points) < 2:
+        return lambda device_ms: points[0][1]
+    n = len(points)
+    mean_x = sum(x for x, _ in points) / n
+    mean_y = sum(y for _, y in points) / n
+    slope = sum((x - mean_x) * (y - mean_y) for x, y in points) / sum((x - mean_x) ** 2 for x, _ in points)
+    # Shift the line below all points so that it stays the lower envelope
+    base = min(y - slope * (x - mean_x) for x, y in points)
+    return lambda device_ms: base + slope * (device_ms - mean_x)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument('evdev', help='event device of the keyboard interface')
+    parser.add_argument('hidraw', help='hidraw device of the vendor interface')
+    parser.add_argument('--duration', type=float, default=30.0, help='seconds to record')
+    parser.add_argument('--interval', type=float, default=0.02, help='seconds between feature report reads')
+    parser.add_argument('--ticks-per-second', type=int, default=TICKS_PER_SECOND,
+                        help='Timer1 rate of the firmware, F_CPU / TIMER_PRESCALER (default %(default)d)')
+    args = parser.parse_args()
+
+    evdev = os.open(args.evdev, os.O_RDONLY | os.O_NONBLOCK)
+    fcntl.ioctl(evdev, EVIOCSCLOCKID(), struct.pack('i', CLOCK_MONOTONIC))
+
+    stages = {name: [] for name in ('uart', 'pickup', 'report', 'usb')}
+    pending_groups, pending_frames, pairs = [], [], []
+    frame, lost_total, unmatched = [], 0, 0
+
+    print('type for %d seconds...' % args.duration)
+    with open(args.hidraw, 'rb+', buffering=0) as device:
+        end = time.monotonic() + args.duration
+        while time.monotonic() < end:
+            select.select([evdev], [], [], args.interval)
+            pending_frames += read_frames(evdev, frame)
+
+            lost, records = read_records(device)
+            if lost:
+                # Records are missing, start pairing over from here
+                lost_total += lost
+                unmatched += len(pending_groups)
+                pending_groups, pending_frames = [], []
+
+            for data, flags, milliseconds, start, decoded, picked_up, written, fetched in records:
+                # the uart timestamps of a byte that sat in the buffer too long may have wrapped
+                if not flags & FLAG_STALE:
+                    stages['uart'].append(ticks_us(start, decoded, args.ticks_per_second))
+                    stages['pickup'].append(ticks_us(decoded, picked_up, args.ticks_per_second))
+                stages['report'].append(ticks_us(picked_up, written, args.ticks_per_second))
+                stages['usb'].append(ticks_us(written, fetched, args.ticks_per_second))
+                if flags & FLAG_UNCHANGED:
+                    continue
+                # Bytes processed before the same report was written share one evdev frame
+                if pending_groups and pending_groups[-1] == (milliseconds, fetched):
+                    continue
+                pending_groups.append((milliseconds, fetched))
+
+            while pending_groups and pending_frames:
+                pairs.append((pending_groups.pop(0)[0], pending_frames.pop(0)))
+
+    os.close(evdev)
+
+    print('%d records, %d lost on the device, %d reports without a matching event' %
+          (len(stages['report']), lost_total, unmatched + len(pending_groups)))
+    if not stages['report']:
+        return
+
+    print('%-8s %9s %9s %9s %9s   (microseconds)' % ('stage', 'p50', 'p90', 'p99', 'max'))
+    for name, values in stages.items():
+        if not values:
+            continue
+        print('%-8s %9.0f %9.0f %9.0f %9.0f' % ((name,) + tuple(percentile(values, p) for p in (50, 90, 99, 100))))
+
+    if pairs:
+        offset = fit_offset(pairs)
+        host = [(host_ms - device_ms - offset(device_ms)) * 1000.0 for device_ms, host_ms in pairs]
+        print('%-8s %9.0f %9.0f %9.0f %9.0f' % (('host',) + tuple(percentile(host, p) for p in (50, 90, 99, 100))))
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,78 @@
+#!/usr/bin/env python3
+"""Prints the raw key events of a keyboard built with RAW_EVENTS=1.
+
+The events are input reports of the vendor specific HID interface (see src/RawEvents.h), which
+Linux exposes as its own /dev/hidrawN next to the keyboard's. Each event is the byte sent by the
+keyboard (bit 7 set for a release, the lower bits are the matrix position) and the time of its
+start bit in microseconds on the device's clock, printed as ? for an event that waited on the device
+too long to be dated. This is meant as the starting point of a host
+side key mapping:
+
+  raw_events.py /dev/hidraw3                  events next to the keyboard reports
+  raw_events.py /dev/hidraw3 --exclusive      events only, the keyboard interface stays silent
+
+The device falls back to the keyboard interface if the events are not read for a while in the
+exclusive mode, and raw events are switched off again when this tool exits.
+"""
+
+import argparse
+import fcntl
+import os
+import struct
+
+REPORTID_EVENTS = 0x05
+REPORTID_MODE = 0x06
+MODE_OFF, MODE_SHARED, MODE_EXCLUSIVE = 0, 1, 2
+
+EVENTS_PER_REPORT = 12
+EVENT = struct.Struct('<BI')
+HEADER = struct.Struct('<BBB')
+RELEASED = 0x80
+TIME_UNKNOWN = 0xFFFFFFFF   # RAW_EVENTS_TIME_Unknown
+
+
+def HIDIOCSFEATURE(length):
+    return (3 << 30) | (length << 16) | (ord('H') << 8) | 0x06
+
+
+def set_mode(device, mode):
+    fcntl.ioctl(device, HIDIOCSFEATURE(2), bytearray([REPORTID_MODE, mode]))
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument('hidraw', help='hidraw device of the vendor interface')
+    parser.add_argument('--exclusive', action='store_true', help='switch off the keyboard reports')
+    args = parser.parse_args()
+
+    device = os.open(args.hidraw, os.O_RDWR)
+    set_mode(device, MODE_EXCLUSIVE if args.exclusive else MODE_SHARED)
+    previous = None
+    try:
+        while True:
+            report = os.read(device, HEADER.size + EVENTS_PER_REPORT * EVENT.size)
+            report_id, count, lost = HEADER.unpack_from(report)
+            if report_id != REPORTID_EVENTS:
+                continue
+            if lost:
+                print('%d events lost' % lost)
+            for i in range(count):
+                data, microseconds = EVENT.unpack_from(report, HEADER.size + i * EVENT.size)
+                if microseconds == TIME_UNKNOWN:
+                    # the event waited on the device too long to be dated
+                    stamp, delta, previous = '%12s' % '?', '', None
+                else:
+                    # the device clock wraps at 2^32 microseconds
+                    stamp = '%12.6f' % (microseconds / 1e6)
+                    delta = '' if previous is None else '+%.3fms' % (((microseconds - previous) & 0xFFFFFFFF) / 1000.0)
+                    previous = microseconds
+                print('%s %10s %-7s 0x%02x' % (stamp, delta, 'release' if data & RELEASED else 'press', data & ~RELEASED))
+    except KeyboardInterrupt:
+        pass
+    finally:
+        set_mode(device, MODE_OFF)
+        os.close(device)
+
+
+if __name__ == '__main__':
+    main()
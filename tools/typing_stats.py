@@ -0,0 +1,91 @@
+#!/usr/bin/env python3
+"""Reads the typing statistics of a keyboard built with TYPING_STATS=1.
+
+The statistics are feature reports of the vendor specific HID interface (see src/TypingStats.h),
+which Linux exposes as its own /dev/hidrawN next to the keyboard's:
+
+  typing_stats.py /dev/hidraw3            print the histograms and the most used keys
+  typing_stats.py /dev/hidraw3 --clear    start over
+"""
+
+import argparse
+import fcntl
+import struct
+
+TIME_BUCKETS = 16
+ROLLOVER_BUCKETS = 8
+KEYS_PER_REPORT = 64
+
+REPORTID_HISTOGRAMS = 0x01
+REPORTID_PRESSCOUNTS_LOW = 0x02
+REPORTID_PRESSCOUNTS_HIGH = 0x03
+
+
+def HIDIOCGFEATURE(length):
+    return (3 << 30) | (length << 16) | (ord('H') << 8) | 0x07
+
+
+def HIDIOCSFEATURE(length):
+    return (3 << 30) | (length << 16) | (ord('H') << 8) | 0x06
+
+
+def get_feature(device, report_id, length):
+    buffer = bytearray(length)
+    buffer[0] = report_id
+    fcntl.ioctl(device, HIDIOCGFEATURE(length), buffer)
+    return bytes(buffer)
+
+
+def bucket_label(bucket):
+    if bucket == 0:
+        return '<1ms'
+    if bucket == TIME_BUCKETS - 1:
+        return '>=%dms' % (1 << (bucket - 1))
+    return '%d-%dms' % (1 << (bucket - 1), (1 << bucket) - 1)
+
+
+def print_histogram(title, labels, counts):
+    print(title)
+    peak = max(counts) or 1
+    for label, count in zip(labels, counts):
+        print('  %12s %6d %s' % (label, count, '#' * (count * 40 // peak)))
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument('hidraw', help='hidraw device of the vendor interface')
+    parser.add_argument('--clear', action='store_true', help='clear the statistics on the device')
+    parser.add_argument('--keys', type=int, default=20, help='number of keys to list')
+    args = parser.parse_args()
+
+    with open(args.hidraw, 'rb+', buffering=0) as device:
+        if args.clear:
+            fcntl.ioctl(device, HIDIOCSFEATURE(2), bytearray([REPORTID_HISTOGRAMS, 0]))
+            return
+
+        fmt = '<BB%dH%dH%dH' % (TIME_BUCKETS, TIME_BUCKETS, ROLLOVER_BUCKETS)
+        fields = struct.unpack(fmt, get_feature(device, REPORTID_HISTOGRAMS, struct.calcsize(fmt)))
+        version, counts = fields[1], fields[2:]
+        if version != 1:
+            raise SystemExit('unknown statistics version %d' % version)
+
+        labels = [bucket_label(b) for b in range(TIME_BUCKETS)]
+        print_histogram('hold time', labels, counts[:TIME_BUCKETS])
+        print_histogram('key interval', labels, counts[TIME_BUCKETS:2 * TIME_BUCKETS])
+        print_histogram('keys already held at a key press',
+                        [str(d) if d < ROLLOVER_BUCKETS - 1 else '%d+' % d for d in range(ROLLOVER_BUCKETS)],
+                        counts[2 * TIME_BUCKETS:])
+
+        fmt = '<B%dH' % KEYS_PER_REPORT
+        presses = []
+        for report_id in (REPORTID_PRESSCOUNTS_LOW, REPORTID_PRESSCOUNTS_HIGH):
+            presses += struct.unpack(fmt, get_feature(device, report_id, struct.calcsize(fmt)))[1:]
+
+        print('presses per raw key code')
+        for raw, count in sorted(enumerate(presses), key=lambda item: -item[1])[:args.keys]:
+            if count:
+                print('  0x%02x %6d' % (raw, count))
+
+
+if __name__ == '__main__':
+    main()
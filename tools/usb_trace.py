@@ -0,0 +1,137 @@
+#!/usr/bin/env python3
+"""Writes the USB transactions recorded by a keyboard built with USB_TRACE=1 to a pcap file.
+
+The firmware records every control request it receives and every report it writes to the keyboard
+and vendor IN endpoints, with the time on the device's microsecond clock (see src/UsbTrace.h), and
+hands the records out as feature reports of the vendor specific HID interface. This tool reads them and
+writes a capture in the Linux usbmon format (LINKTYPE_USB_LINUX_MMAPPED), which Wireshark opens
+like one taken with usbmon on the host:
+
+  usb_trace.py /dev/hidraw3 keyboard.pcap                 until Ctrl-C
+  usb_trace.py /dev/hidraw3 keyboard.pcap --duration 60
+
+The records start at power up, so the first ones are the enumeration. Timestamps are the device's
+time since power up, at which the firmware handled a request or wrote a report; the capture has
+no host side times. Control requests are written as a submission with the setup packet and a
+completion, which stands for the data and status stages: it has the size of the data stage in
+either direction and the status, -EPIPE for a request the device stalled. The bytes of the data
+stage are not recorded by the firmware and are left out, descriptors included. Reports are
+written as completions of their interrupt IN endpoint with their first 8 bytes, the whole report
+for the keyboard. The reads of the trace itself are not recorded.
+"""
+
+import argparse
+import fcntl
+import os
+import struct
+import time
+
+REPORTID = 0x07
+RECORDS_PER_REPORT = 6
+DATA_SIZE = 8
+RECORD = struct.Struct('<IBH%ds' % DATA_SIZE)
+HEADER = struct.Struct('<BBB')
+REPORT_LENGTH = HEADER.size + RECORDS_PER_REPORT * RECORD.size
+
+LINKTYPE_USB_LINUX_MMAPPED = 220
+PCAP_HEADER = struct.Struct('<IHHiIII')
+PCAP_RECORD = struct.Struct('<IIII')
+# struct usbmon_packet of Documentation/usb/usbmon.rst, 64 bytes in host byte order
+USBMON = struct.Struct('<QBBBBHBBqiiII8siiII')
+XFER_INTERRUPT, XFER_CONTROL = 1, 2
+USB_DIR_IN = 0x80
+CONTROL_STALLED = 0x40      # USB_TRACE_CONTROL_Stalled
+EPIPE = 32
+NO_SETUP, DATA_IN, DATA_OUT = ord('-'), ord('<'), ord('>')
+
+
+def HIDIOCGFEATURE(length):
+    return (3 << 30) | (length << 16) | (ord('H') << 8) | 0x07
+
+
+def read_records(device):
+    """Returns the lost count and the records of one feature report."""
+    buffer = bytearray(REPORT_LENGTH)
+    buffer[0] = REPORTID
+    fcntl.ioctl(device, HIDIOCGFEATURE(REPORT_LENGTH), buffer)
+    _, count, lost = HEADER.unpack_from(buffer)
+    return lost, [RECORD.unpack_from(buffer, HEADER.size + i * RECORD.size) for i in range(count)]
+
+
+class Capture:
+    def __init__(self, output, bus, device):
+        self.output = output
+        self.bus = bus
+        self.device = device
+        self.urb = 0
+        self.previous = None
+        self.wraps = 0
+        output.write(PCAP_HEADER.pack(0xa1b2c3d4, 2, 4, 0, 0, 65535, LINKTYPE_USB_LINUX_MMAPPED))
+
+    def time(self, microseconds):
+        """Unwraps the device's 32-bit microsecond clock."""
+        if self.previous is not None and microseconds < self.previous and self.previous - microseconds > 1 << 31:
+            self.wraps += 1
+        self.previous = microseconds
+        return (self.wraps << 32) + microseconds
+
+    def packet(self, when, kind, xfer, endpoint, setup_flag, data_flag, length, setup=bytes(8), data=b'', interval=0,
+               status=0):
+        header = USBMON.pack(self.urb, ord(kind), xfer, endpoint, self.device, self.bus, setup_flag, data_flag,
+                             when // 1000000, when % 1000000, status, length, len(data), setup, interval, 0, 0, 0)
+        self.output.write(PCAP_RECORD.pack(when // 1000000, when % 1000000,
+                                           len(header) + len(data), len(header) + len(data)))
+        self.output.write(header + data)
+
+    def record(self, microseconds, endpoint, length, data):
+        when = self.time(microseconds)
+        self.urb += 1
+        if endpoint in (0, CONTROL_STALLED):
+            direction = data[0] & USB_DIR_IN
+            data_flag = DATA_IN if direction else DATA_OUT
+            requested = struct.unpack_from('<H', data, 6)[0]
+            self.packet(when, 'S', XFER_CONTROL, direction, 0, data_flag, requested, setup=data)
+            # length is the data stage in either direction, the firmware sets it to 0 for a stall
+            self.packet(when, 'C', XFER_CONTROL, direction, NO_SETUP, data_flag, length,
+                        status=-EPIPE if endpoint == CONTROL_STALLED else 0)
+        else:
+            self.packet(when, 'C', XFER_INTERRUPT, endpoint, NO_SETUP, 0, length,
+                        data=data[:min(length, DATA_SIZE)], interval=1)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument('hidraw', help='hidraw device of the vendor interface')
+    parser.add_argument('pcap', type=argparse.FileType('wb'), help='capture file to write')
+    parser.add_argument('--duration', type=float, help='seconds to record, until Ctrl-C by default')
+    parser.add_argument('--interval', type=float, default=0.02, help='seconds between feature report reads')
+    parser.add_argument('--bus', type=int, default=1, help='bus number written to the capture')
+    parser.add_argument('--device', type=int, default=1, help='device address written to the capture')
+    args = parser.parse_args()
+
+    capture = Capture(args.pcap, args.bus, args.device)
+    records = lost_total = 0
+    end = None if args.duration is None else time.monotonic() + args.duration
+    device = os.open(args.hidraw, os.O_RDWR)
+    try:
+        while end is None or time.monotonic() < end:
+            lost, batch = read_records(device)
+            lost_total += lost
+            for record in batch:
+                capture.record(*record)
+            records += len(batch)
+            args.pcap.flush()
+            # the device holds more than one report, read on until it is empty
+            if len(batch) < RECORDS_PER_REPORT:
+                time.sleep(args.interval)
+    except KeyboardInterrupt:
+        pass
+    finally:
+        os.close(device)
+        args.pcap.close()
+
+    print('%d transactions, %d lost on the device' % (records, lost_total))
+
+
+if __name__ == '__main__':
+    main()